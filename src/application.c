@@ -131,7 +131,9 @@ static void update_draw_game(void)
         instanciate_menu();
     }
     else if (game_logic_data->order == RESTART_GAME) {
-        instanciate_game(game_logic_data->mode);
+        const GameMode mode = game_logic_data->mode;
+        exit_game();
+        instanciate_game(mode);
         game_logic_data->game_state = GAME_STATE_PLAYING;
     }
 }
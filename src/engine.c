@@ -131,6 +131,14 @@ f32 get_frame_time(void)
     return GetFrameTime();
 }
 
+// Time in seconds that does not depend on the window, usable from any thread
+f64 get_precise_time(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec * 1e-9;
+}
+
 // Input-related functions
 b32 is_mouse_button_pressed(i32 button)
 {
@@ -7,11 +7,15 @@
 #include <time.h>   // for time() function
 
 typedef unsigned char u8;
+typedef unsigned short u16;
 typedef unsigned int u32;
 typedef unsigned long long u64;
+typedef signed char i8;
+typedef short i16;
 typedef int i32;
 typedef int b32;
 typedef float f32;
+typedef double f64;
 
 #define true 1
 #define false 0
@@ -162,6 +166,7 @@ b32 window_should_close(void);
 // Timing-related functions
 void set_target_fps(i32 fps);
 f32 get_frame_time(void);
+f64 get_precise_time(void);
 
 // Input-related functions
 b32 is_mouse_button_pressed(i32 button);
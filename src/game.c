@@ -43,17 +43,20 @@ static void init_game_rendering_data(GameGlobalRenderingData *game_global_render
     rendering_data->stack_top_card_ui.is_pressed = false;
 }
 
-static void init_board(Tile board[][BOARD_COLUMNS_NB])
+/**
+ * Deal the 16 cards on the board in a random order, with rand()
+ * After srand(seed), the deal only depends on the seed (and on the libc implementation of rand())
+ */
+void deal_cards(Tile board[][BOARD_COLUMNS_NB])
 {
     // Create an array with all the cards
-    const i32 board_tiles_number = BOARD_ROWS_NB * BOARD_COLUMNS_NB;
-    TileType cards[board_tiles_number];
-    for (i32 i = 0; i < board_tiles_number; i++) {
+    TileType cards[BOARD_CELLS_NB];
+    for (i32 i = 0; i < BOARD_CELLS_NB; i++) {
         cards[i] = (TileType)i;
     }
 
     // Shuffle the array with the cards
-    for (i32 i = board_tiles_number - 1; i > 0; i--) {
+    for (i32 i = BOARD_CELLS_NB - 1; i > 0; i--) {
         i32 j = rand() % (i + 1);
         TileType temp = cards[i];
         cards[i] = cards[j];
@@ -62,8 +65,8 @@ static void init_board(Tile board[][BOARD_COLUMNS_NB])
 
     // Put all the shuffled cards in the board
     i32 k = 0;
-    for (i32 i = 0; i < 4; i++) {
-        for (i32 j = 0; j < 4; j++) {
+    for (i32 i = 0; i < BOARD_ROWS_NB; i++) {
+        for (i32 j = 0; j < BOARD_COLUMNS_NB; j++) {
             board[i][j].type = cards[k++];
             board[i][j].is_pressed = false;
         }
@@ -83,7 +86,7 @@ static void init_game_logic_data(GameLogicData *game, const BoardGlobalRendering
 
     game->order = ORDER_NONE;
 
-    init_board(game->board);
+    deal_cards(game->board);
 
     game->stack_top_card.type = EMPTY_TILE;
     game->stack_top_card.is_pressed = false;
@@ -94,6 +97,13 @@ static void init_game_logic_data(GameLogicData *game, const BoardGlobalRendering
     game->player2_remaining_tokens = PLAYER_STACK_TOKENS_SLOTS;
 
     game->ai_thinking_duration = 0.0f;
+    init_bot_settings(&game->bot_settings);
+    // The network is optional: if its file is missing or invalid, the bot falls back to the pattern table
+    game->bot_network = (mode == MODE_ONE_PLAYER) ? load_evaluation_network("./src/assets/evaluation_network.bin") : NULL;
+    game->bot_settings.network = game->bot_network;
+    game->bot_search = NULL;
+    game->bot_ponder = NULL;
+    game->bot_memory = (mode == MODE_ONE_PLAYER) ? create_search_memory(&game->bot_settings) : NULL;
 
     sprintf(game->info_message_p1.message, " ");
     game->info_message_p1.display_time = 0.0f;
@@ -142,6 +152,10 @@ void instanciate_game(const GameMode mode)
 
 void exit_game(void)
 {
+    stop_bot_search(game_logic_data->bot_search);
+    stop_bot_ponder(game_logic_data->bot_ponder);
+    destroy_search_memory(game_logic_data->bot_memory);
+    destroy_evaluation_network(game_logic_data->bot_network);
     free(game_logic_data);
     free(game_global_rendering_data);
     free(game_global_animations_data);
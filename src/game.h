@@ -5,8 +5,24 @@
 
 #define BOARD_ROWS_NB 4
 #define BOARD_COLUMNS_NB 4
+#define BOARD_CELLS_NB (BOARD_ROWS_NB * BOARD_COLUMNS_NB)
 #define PLAYER_STACK_TOKENS_SLOTS 8
 
+#define CARD_TYPES_NB 16
+#define CARD_COLORS_NB 8
+#define WIN_PATTERNS_NB 19
+#define CELL_WIN_PATTERNS_MAX 7
+#define SYMMETRIES_NB 8 // rotations and reflections of the board
+
+// Cell n of the packed board is the tile board[n / BOARD_COLUMNS_NB][n % BOARD_COLUMNS_NB]
+#define CELL_INDEX(x, y) ((x) * BOARD_COLUMNS_NB + (y))
+#define CELL_BIT(cell) ((u16)(1u << (cell)))
+#define FULL_BOARD_MASK 0xFFFF
+
+// A card shows one of the four "first" colors (blue, yellow, orange, skyblue) and one of the four "second" colors (red, purple, green, brown)
+#define CARD_FIRST_COLOR(card) ((card) >> 2)
+#define CARD_SECOND_COLOR(card) (4 + ((card) & 3))
+
 #define rendering_data game_global_rendering_data
 
 typedef enum {
@@ -46,6 +62,32 @@ typedef enum {
     PLAYER2 = 2
 } Player;
 
+/**
+ * Packed board used by the bot search
+ * Every field is a 16 bits mask indexed with CELL_INDEX(), so move generation and terminal checks are a few mask operations
+ */
+typedef struct {
+    u64 key;                    // zobrist key of the tokens, the last discarded card and the side to move
+    u16 tokens[2];              // cells covered by a token of player 1 / player 2
+    u16 colors[CARD_COLORS_NB]; // uncovered cells whose card shows each color
+    u8 last_card;               // last discarded card, EMPTY_TILE before the first move
+    u8 side_to_move;            // 0 for player 1, 1 for player 2
+} Position;
+
+/**
+ * State of the game for the side to move, see position_outcome()
+ */
+typedef enum {
+    POSITION_ONGOING,
+    POSITION_DRAW, // the board is full
+    POSITION_LOST, // the previous player completed a pattern, or the side to move cannot play
+} PositionOutcome;
+
+typedef struct {
+    u8 count;
+    u8 patterns[CELL_WIN_PATTERNS_MAX];
+} CellWinPatterns;
+
 typedef enum {
     GAME_STATE_PLAYING,
     GAME_STATE_WIN,
@@ -63,6 +105,65 @@ typedef struct {
     f32 display_time;
 } InfoMessage;
 
+typedef enum {
+    BOT_ALGORITHM_MINIMAX, // alpha-beta with separate maximizing and minimizing branches
+    BOT_ALGORITHM_PVS,     // principal variation search (negascout), null-window searches for the moves after the first one
+} BotAlgorithm;
+
+typedef enum {
+    BOT_ENGINE_MINIMAX, // depth-limited search with the evaluation, see BotAlgorithm
+    BOT_ENGINE_MCTS,    // monte carlo tree search, random playouts instead of an evaluation
+} BotEngine;
+
+typedef enum {
+    BOT_PARALLEL_ROOT_SPLIT, // the root moves are split between the threads
+    BOT_PARALLEL_LAZY_SMP,   // every thread searches the whole root at staggered depths, they only share the transposition table
+    BOT_PARALLEL_WORK_STEALING, // young brothers wait: the siblings of a searched first child become tasks for idle threads
+} BotParallelism;
+
+typedef struct EvaluationNetwork EvaluationNetwork;
+
+/**
+ * Per-game settings of the bot
+ * The search always has a move ready, it stops at the first of the time, node or depth limits
+ */
+typedef struct {
+    BotEngine engine;
+    BotAlgorithm algorithm;
+    f32 time_budget;       // seconds the search may take for one move
+    u64 node_budget;       // maximum number of searched positions for one move, 0 for no limit
+    i32 max_depth;         // maximum number of plies searched after the bot move
+    i32 tt_size_log2;      // the transposition table holds 2^tt_size_log2 entries
+    b32 canonical_tt;      // key the transposition table by the canonical position, so equivalent positions share their entry
+    b32 move_ordering;     // try the transposition table move, wins, blocks, killers and history moves first
+    i32 endgame_threshold; // positions with at most this number of uncovered cards are solved exactly, 0 to disable
+    i32 threads;           // threads of the search (the web build always uses 1)
+    BotParallelism parallelism;
+    f32 reply_delay;       // pause before the bot searches, so the player can follow the game
+    b32 ponder;            // search the replies to every human move during the human turn (not on the web)
+    f32 slice_time;        // seconds of search per frame when the search cannot have its own thread (web build)
+    u64 playout_budget;    // maximum number of MCTS playouts for one move, 0 for no limit
+    f32 mcts_exploration;  // UCT exploration constant, higher values try the less visited moves more often
+    b32 batched_playouts;  // each MCTS leaf is scored by a batch of playouts run together in SIMD lanes, instead of a single one
+    u32 mcts_arena_nodes;  // nodes of the MCTS tree, it stops growing once they are used (a tree kept between moves takes twice that)
+    const EvaluationNetwork *network; // scores the minimax leaves instead of the pattern table, NULL for the pattern table (see load_evaluation_network())
+} BotSettings;
+
+/**
+ * Bot search running in the background, see start_bot_search()
+ */
+typedef struct BotSearch BotSearch;
+
+/**
+ * Bot searches made during the human turn, see start_bot_ponder()
+ */
+typedef struct BotPonder BotPonder;
+
+/**
+ * Transposition table, killers and history kept by the bot between its moves, see create_search_memory()
+ */
+typedef struct SearchMemory SearchMemory;
+
 typedef struct {
     GameMode mode;
     GameState game_state;
@@ -77,6 +178,11 @@ typedef struct {
     i32 player2_remaining_tokens;
 
     f32 ai_thinking_duration;
+    BotSettings bot_settings;
+    BotSearch *bot_search; // running bot search, NULL when the bot is not thinking
+    BotPonder *bot_ponder; // searches of the human turn, NULL when the bot is not pondering
+    SearchMemory *bot_memory; // search state kept by the bot for the whole game, NULL in a two player game
+    EvaluationNetwork *bot_network; // evaluation of the bot, NULL when the bot uses the pattern table
 
     InfoMessage info_message_p1;
     InfoMessage info_message_p2;
@@ -154,9 +260,43 @@ extern GameGlobalRenderingData *game_global_rendering_data;
 extern GameAnimationsData *game_global_animations_data;
 
 Color get_tile_color(const TileType tile_type, const i32 color_number);
-Vec2i get_ai_pressed_tile(Tile board[][BOARD_COLUMNS_NB], const Tile stack_top_card);
+void init_bot_settings(BotSettings *settings);
+BotSearch *start_bot_search(Tile board[][BOARD_COLUMNS_NB], const Tile stack_top_card, const BotSettings *settings, SearchMemory *memory, BotPonder *ponder);
+b32 poll_bot_search(BotSearch *search, Vec2i *pressed_tile);
+void stop_bot_search(BotSearch *search);
+BotPonder *start_bot_ponder(Tile board[][BOARD_COLUMNS_NB], const Tile stack_top_card, const BotSettings *settings, SearchMemory *memory);
+SearchMemory *create_search_memory(const BotSettings *settings);
+void destroy_search_memory(SearchMemory *memory);
+EvaluationNetwork *load_evaluation_network(const char *filepath);
+void destroy_evaluation_network(EvaluationNetwork *network);
+void stop_bot_ponder(BotPonder *ponder);
+extern const u16 card_compatibility[CARD_TYPES_NB];
 b32 have_common_color(const TileType tile1_type, const TileType tile2_type);
 b32 is_board_full(const Tile board[][BOARD_COLUMNS_NB]);
+void deal_cards(Tile board[][BOARD_COLUMNS_NB]);
+
+// bitboards
+extern const u16 win_patterns[WIN_PATTERNS_NB];
+extern const CellWinPatterns cell_win_patterns[BOARD_CELLS_NB];
+Position position_from_board(const Tile board[][BOARD_COLUMNS_NB], const TileType last_card, const Player side_to_move);
+TileType position_card_at(const Position *pos, const i32 cell);
+u16 position_legal_moves(const Position *pos);
+TileType position_make_move(Position *pos, const i32 cell);
+void position_unmake_move(Position *pos, const i32 cell, const TileType previous_last_card);
+b32 position_is_full(const Position *pos);
+PositionOutcome position_outcome(const Position *pos, const i32 last_cell, u16 *moves);
+u64 position_compute_key(const Position *pos);
+b32 has_winning_pattern(const u16 tokens);
+b32 is_winning_cell(const u16 tokens, const i32 cell);
+u16 winning_cells(const u16 tokens);
+i32 count_bits(const u16 mask);
+
+// symmetries
+extern const u8 symmetry_cells[SYMMETRIES_NB][BOARD_CELLS_NB];
+extern const u8 symmetry_inverse[SYMMETRIES_NB];
+Position position_transform(const Position *pos, const i32 symmetry, const u8 first_colors[4], const u8 second_colors[4]);
+Position position_canonical(const Position *pos, i32 *symmetry);
+u64 position_canonical_key(const Position *pos, i32 *symmetry);
 
 // animations
 void update_animation(AnimationData *animation_data);
@@ -0,0 +1,230 @@
+#include "game.h"
+
+/**
+ * The 19 ways to win: 4 lines, 4 columns, 2 diagonals and 9 2x2 squares
+ */
+const u16 win_patterns[WIN_PATTERNS_NB] = {
+    // Lines (board[i][0..3])
+    0x000F, 0x00F0, 0x0F00, 0xF000,
+    // Columns (board[0..3][j])
+    0x1111, 0x2222, 0x4444, 0x8888,
+    // Diagonals
+    0x8421, 0x1248,
+    // 2x2 squares
+    0x0033, 0x0066, 0x00CC,
+    0x0330, 0x0660, 0x0CC0,
+    0x3300, 0x6600, 0xCC00,
+};
+
+/**
+ * Indexes in win_patterns[] of the patterns going through each cell
+ * After a move, only these patterns have to be checked
+ */
+const CellWinPatterns cell_win_patterns[BOARD_CELLS_NB] = {
+    {4, {0, 4, 8, 10}},
+    {4, {0, 5, 10, 11}},
+    {4, {0, 6, 11, 12}},
+    {4, {0, 7, 9, 12}},
+    {4, {1, 4, 10, 13}},
+    {7, {1, 5, 8, 10, 11, 13, 14}},
+    {7, {1, 6, 9, 11, 12, 14, 15}},
+    {4, {1, 7, 12, 15}},
+    {4, {2, 4, 13, 16}},
+    {7, {2, 5, 9, 13, 14, 16, 17}},
+    {7, {2, 6, 8, 14, 15, 17, 18}},
+    {4, {2, 7, 15, 18}},
+    {4, {3, 4, 9, 16}},
+    {4, {3, 5, 16, 17}},
+    {4, {3, 6, 17, 18}},
+    {4, {3, 7, 8, 18}},
+};
+
+/**
+ * Zobrist keys, the key of a position is the xor of the keys of its tokens, of its last discarded card and of the side to move
+ */
+static const u64 zobrist_tokens[2][BOARD_CELLS_NB] = {
+    {
+        0x932AD589BD49D05DULL, 0xE8659DE710164353ULL, 0x816AB057101A4A36ULL, 0x3C7F47571579B9D1ULL,
+        0xB0F8EE1E35B64415ULL, 0x89C9063633E6AF1FULL, 0x22421028FAD95284ULL, 0xF3D849065312B92DULL,
+        0xF055BA8457B57B1DULL, 0x249F2C9D57091322ULL, 0xEF97492A67E53CD5ULL, 0x1027C86263BECD36ULL,
+        0x72FF8E3C3B8AC5F8ULL, 0x7BD54CCEE6880903ULL, 0x495B54C9D4FFB87AULL, 0xCD2B7A4F6E35DC43ULL,
+    },
+    {
+        0x881159ECBCC23E2AULL, 0x5E7E13E6C38DE1FDULL, 0xDE43C69470D6BFF5ULL, 0xA21250175532CD3FULL,
+        0x4CA73940B71DBBE1ULL, 0x85E44A97BFE8FE1DULL, 0xEA4ECED425F7C00CULL, 0xC31A2487F4003B91ULL,
+        0xD2E22B9F203007C9ULL, 0x00D617C6AE6AF46FULL, 0x0C63BA7C5CAA2AECULL, 0x091552C4D6AEC4B2ULL,
+        0xAE2B71B2A0BEA014ULL, 0x88D0CC11DB505F3FULL, 0x9B51BAD580FD4B51ULL, 0x489A8F3FF59200A5ULL,
+    },
+};
+// Indexed by TileType, tokens and EMPTY_TILE do not change the key
+static const u64 zobrist_last_card[EMPTY_TILE + 1] = {
+    0x64CDDB4D71C3742BULL, 0xB1A2510F4BE26C56ULL, 0x26FEAA55EC65E4FAULL, 0x62D7AAECFA6D0041ULL,
+    0xCBD9DBED4BACEC33ULL, 0x4D1C1621A0C586BFULL, 0x56E0C8505AF4025EULL, 0xA4645D5E86F146EFULL,
+    0xD8707B9B43E3E184ULL, 0xABA34A27F0732CD6ULL, 0x5F83D0C6C09AE7EAULL, 0xD1FC9C6AAB87F7C0ULL,
+    0x121B603B4A3B3623ULL, 0xD38CB9A3DD564C6AULL, 0xA2A0971A6C25FFB3ULL, 0xEE56E96924F70765ULL,
+};
+static const u64 zobrist_side = 0xC9F32D720091A032ULL;
+
+i32 count_bits(const u16 mask)
+{
+    return __builtin_popcount(mask);
+}
+
+Position position_from_board(const Tile board[][BOARD_COLUMNS_NB], const TileType last_card, const Player side_to_move)
+{
+    Position pos = {0};
+    pos.last_card = last_card;
+    pos.side_to_move = (side_to_move == PLAYER1) ? 0 : 1;
+
+    for (i32 i = 0; i < BOARD_ROWS_NB; i++) {
+        for (i32 j = 0; j < BOARD_COLUMNS_NB; j++) {
+            const u16 bit = CELL_BIT(CELL_INDEX(i, j));
+            const TileType type = board[i][j].type;
+            if (type == TOKEN_PLAYER1) {
+                pos.tokens[0] |= bit;
+            }
+            else if (type == TOKEN_PLAYER2) {
+                pos.tokens[1] |= bit;
+            }
+            else {
+                pos.colors[CARD_FIRST_COLOR(type)] |= bit;
+                pos.colors[CARD_SECOND_COLOR(type)] |= bit;
+            }
+        }
+    }
+
+    pos.key = position_compute_key(&pos);
+    return pos;
+}
+
+/**
+ * Compute the zobrist key from scratch, the search keeps it up to date incrementally in position_make_move() and position_unmake_move()
+ */
+u64 position_compute_key(const Position *pos)
+{
+    u64 key = zobrist_last_card[pos->last_card];
+    if (pos->side_to_move) {
+        key ^= zobrist_side;
+    }
+    for (i32 side = 0; side < 2; side++) {
+        for (u16 remaining = pos->tokens[side]; remaining != 0; remaining &= remaining - 1) {
+            key ^= zobrist_tokens[side][__builtin_ctz(remaining)];
+        }
+    }
+    return key;
+}
+
+/**
+ * Rebuild the card of an uncovered cell from the color masks
+ * Exactly one first color and one second color mask contain the cell
+ */
+TileType position_card_at(const Position *pos, const i32 cell)
+{
+    const i32 first = ((pos->colors[1] >> cell) & 1) | (((pos->colors[2] >> cell) & 1) * 2) | (((pos->colors[3] >> cell) & 1) * 3);
+    const i32 second = ((pos->colors[5] >> cell) & 1) | (((pos->colors[6] >> cell) & 1) * 2) | (((pos->colors[7] >> cell) & 1) * 3);
+    return (TileType)(first * 4 + second);
+}
+
+/**
+ * Return the mask of the cells the side to move can cover
+ * On the first turn every card can be taken, except the four central ones
+ */
+u16 position_legal_moves(const Position *pos)
+{
+    if (pos->last_card == EMPTY_TILE) {
+        return ~(pos->tokens[0] | pos->tokens[1] | 0x0660);
+    }
+    return pos->colors[CARD_FIRST_COLOR(pos->last_card)] | pos->colors[CARD_SECOND_COLOR(pos->last_card)];
+}
+
+/**
+ * Cover a cell with a token of the side to move, its card becomes the last discarded card
+ * This function returns the previous last discarded card, it has to be given back to position_unmake_move()
+ */
+TileType position_make_move(Position *pos, const i32 cell)
+{
+    const TileType previous_last_card = pos->last_card;
+    const TileType card = position_card_at(pos, cell);
+    const u16 bit = CELL_BIT(cell);
+
+    pos->colors[CARD_FIRST_COLOR(card)] &= ~bit;
+    pos->colors[CARD_SECOND_COLOR(card)] &= ~bit;
+    pos->tokens[pos->side_to_move] |= bit;
+    pos->key ^= zobrist_tokens[pos->side_to_move][cell] ^ zobrist_last_card[previous_last_card] ^ zobrist_last_card[card] ^ zobrist_side;
+    pos->last_card = card;
+    pos->side_to_move ^= 1;
+
+    return previous_last_card;
+}
+
+void position_unmake_move(Position *pos, const i32 cell, const TileType previous_last_card)
+{
+    // The card taken by the move is still on the top of the stack
+    const TileType card = pos->last_card;
+    const u16 bit = CELL_BIT(cell);
+
+    pos->side_to_move ^= 1;
+    pos->tokens[pos->side_to_move] &= ~bit;
+    pos->key ^= zobrist_tokens[pos->side_to_move][cell] ^ zobrist_last_card[previous_last_card] ^ zobrist_last_card[card] ^ zobrist_side;
+    pos->colors[CARD_FIRST_COLOR(card)] |= bit;
+    pos->colors[CARD_SECOND_COLOR(card)] |= bit;
+    pos->last_card = previous_last_card;
+}
+
+b32 position_is_full(const Position *pos)
+{
+    return (pos->tokens[0] | pos->tokens[1]) == FULL_BOARD_MASK;
+}
+
+/**
+ * Rules of the end of the game, after the move `last_cell` (-1 at the root when it is unknown)
+ * A full board is a draw, even if the last token completes a pattern. Otherwise the previous player has won
+ * if it completed a pattern, which can only go through `last_cell`, or if the side to move cannot play
+ * The legal moves of the side to move are written in `moves`, they are 0 on a full board
+ */
+PositionOutcome position_outcome(const Position *pos, const i32 last_cell, u16 *moves)
+{
+    if (position_is_full(pos)) {
+        *moves = 0;
+        return POSITION_DRAW;
+    }
+    *moves = position_legal_moves(pos);
+    if ((last_cell >= 0 && is_winning_cell(pos->tokens[pos->side_to_move ^ 1], last_cell)) || *moves == 0) {
+        return POSITION_LOST;
+    }
+    return POSITION_ONGOING;
+}
+
+b32 has_winning_pattern(const u16 tokens)
+{
+    return winning_cells(tokens) != 0;
+}
+
+/**
+ * Return true if one of the patterns going through `cell` is fully covered by `tokens`
+ */
+b32 is_winning_cell(const u16 tokens, const i32 cell)
+{
+    const CellWinPatterns *cell_patterns = &cell_win_patterns[cell];
+    for (i32 i = 0; i < cell_patterns->count; i++) {
+        const u16 pattern = win_patterns[cell_patterns->patterns[i]];
+        if ((tokens & pattern) == pattern) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Return the mask of the cells that belong to a pattern fully covered by `tokens`
+ */
+u16 winning_cells(const u16 tokens)
+{
+    u16 cells = 0;
+    for (i32 i = 0; i < WIN_PATTERNS_NB; i++) {
+        if ((tokens & win_patterns[i]) == win_patterns[i]) {
+            cells |= win_patterns[i];
+        }
+    }
+    return cells;
+}
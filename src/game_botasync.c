@@ -0,0 +1,376 @@
+#ifndef PLATFORM_WEB
+#include <pthread.h>
+#endif
+
+#include "game_botbrain.h"
+
+/**
+ * Searches made during the human turn: the thread searches the bot reply to each legal human move in turn
+ * All the searches fill the memory of the bot, so once the human has played,
+ * the bot either answers with the reply already found or searches again with a warm transposition table
+ * With MCTS, the thread searches the human turn itself instead, see run_bot_ponder_mcts()
+ */
+struct BotPonder {
+    Position pos; // human to move
+    BotSettings settings;
+    SearchMemory *memory;
+
+    atomic_bool cancel;
+    atomic_int replies[BOARD_CELLS_NB]; // bot reply to each human move, NO_MOVE until its search is complete
+    atomic_int searching;               // human move whose reply is being searched, NO_MOVE when the thread is done
+    atomic_int played;                  // human move once it is known, the thread then only searches the reply to it
+
+#ifndef PLATFORM_WEB
+    pthread_t thread_id;
+    b32 is_thread_started;
+#endif
+};
+
+/**
+ * Bot search running on its own thread, so the frames go on while the bot thinks
+ * The thread only reads its own copy of the position and writes `best_cell` before setting `is_done`
+ * Without thread (web build), the search is sliced instead: each poll searches for settings.slice_time
+ */
+struct BotSearch {
+    Position pos;
+    BotSettings settings;
+
+    SearchMemory *memory; // can be NULL
+
+    // Pondering of the human turn that led to `pos`, the search can wait for its reply
+    BotPonder *ponder;
+    i32 played;
+
+    atomic_bool cancel;
+    atomic_bool is_done;
+    i32 best_cell;
+
+    // NULL when the search runs on its own thread, only the one of the engine is set otherwise
+    SlicedSearch *sliced;
+    MctsSearch *mcts;
+#ifndef PLATFORM_WEB
+    pthread_t thread_id;
+    b32 is_thread_started;
+#endif
+};
+
+static void log_bot_search(const u64 nodes, const f64 time, const i32 depth, const u64 tt_hits, const u64 tt_reused)
+{
+    const f64 reuse_rate = (tt_hits != 0) ? 100.0 * (f64)tt_reused / (f64)tt_hits : 0.0;
+    trace_log(LOG_INFO, "Bot searched %llu positions in %.3f s (depth %d), %.1f%% of its table hits come from earlier searches", nodes, time, depth, reuse_rate);
+}
+
+static void log_bot_mcts(const u64 playouts, const f64 time, const i32 depth, const u64 reused_visits)
+{
+    trace_log(LOG_INFO, "Bot ran %llu playouts in %.3f s (tree depth %d), %llu visits of the root come from earlier searches", playouts, time, depth, reused_visits);
+}
+
+/**
+ * Search for one slice, on the main thread
+ */
+static void run_bot_search_slice(BotSearch *search)
+{
+    if (search->mcts != NULL) {
+        MctsSearch *mcts = search->mcts;
+        if (run_mcts_search(mcts, search->settings.slice_time)) {
+            search->best_cell = get_mcts_best_move(mcts);
+            atomic_store_explicit(&search->is_done, true, memory_order_release);
+            log_bot_mcts(mcts->playouts, search->settings.time_budget - mcts->time_left, mcts->tree_depth, mcts->reused_visits);
+        }
+        return;
+    }
+
+    SlicedSearch *sliced = search->sliced;
+    if (!run_sliced_search(sliced, search->settings.slice_time)) {
+        return;
+    }
+
+    search->best_cell = sliced->best_cell;
+    atomic_store_explicit(&search->is_done, true, memory_order_release);
+    const TranspositionTable *tt = &sliced->memory->tt;
+    log_bot_search(sliced->ctx.nodes, search->settings.time_budget - sliced->time_left, sliced->completed_depth, tt->hits, tt->reused);
+}
+
+#ifndef PLATFORM_WEB
+static void run_bot_search(BotSearch *search)
+{
+    if (search->memory == NULL) {
+        search->best_cell = search_best_move(&search->pos, &search->settings, &search->cancel, NULL);
+        atomic_store_explicit(&search->is_done, true, memory_order_release);
+        return;
+    }
+
+    SearchStats stats;
+    search->best_cell = search_best_move_with_memory(&search->pos, &search->settings, search->memory, &search->cancel, &stats);
+    atomic_store_explicit(&search->is_done, true, memory_order_release);
+    if (search->settings.engine == BOT_ENGINE_MCTS) {
+        log_bot_mcts(stats.nodes, stats.time, stats.depth, stats.mcts_reused);
+    }
+    else {
+        log_bot_search(stats.nodes, stats.time, stats.depth, stats.tt_hits, stats.tt_reused);
+    }
+}
+
+static void *run_bot_search_thread(void *arg)
+{
+    run_bot_search(arg);
+    return NULL;
+}
+
+/**
+ * The MCTS replies all live in the tree of the human turn: one search of the human turn grows them together,
+ * and the bot search then keeps the subtree of the played move. Searching each reply in turn would re-root
+ * the shared tree on every reply, and the bot search would only find the last one
+ * The search gets the budget of all the replies, and start_bot_search() cancels it once the human has played
+ */
+static void run_bot_ponder_mcts(BotPonder *ponder)
+{
+    const i32 moves_nb = count_bits(position_legal_moves(&ponder->pos));
+    BotSettings settings = ponder->settings;
+    settings.time_budget *= moves_nb;
+    settings.playout_budget *= moves_nb;
+
+    SearchStats stats;
+    search_best_move_with_memory(&ponder->pos, &settings, ponder->memory, &ponder->cancel, &stats);
+    trace_log(LOG_DEBUG, "pondering: %llu playouts in %.3f s", stats.nodes, stats.time);
+}
+
+static void *run_bot_ponder_thread(void *arg)
+{
+    BotPonder *ponder = arg;
+    const i32 human_side = ponder->pos.side_to_move;
+
+    if (ponder->settings.engine == BOT_ENGINE_MCTS) {
+        run_bot_ponder_mcts(ponder);
+        atomic_store(&ponder->searching, NO_MOVE);
+        return NULL;
+    }
+
+    for (u16 moves = position_legal_moves(&ponder->pos); moves != 0; moves &= moves - 1) {
+        const i32 cell = __builtin_ctz(moves);
+        // Once the human has played, only the reply to the played move is still worth searching
+        atomic_store(&ponder->searching, cell);
+        const i32 played = atomic_load(&ponder->played);
+        if (played != NO_MOVE && played != cell) {
+            break;
+        }
+
+        // Nothing to search when the human move ends the game
+        Position next = ponder->pos;
+        position_make_move(&next, cell);
+        if (has_winning_pattern(next.tokens[human_side]) || position_legal_moves(&next) == 0) {
+            continue;
+        }
+
+        const i32 reply = search_best_move_with_memory(&next, &ponder->settings, ponder->memory, &ponder->cancel, NULL);
+        if (atomic_load(&ponder->cancel)) {
+            break;
+        }
+        atomic_store(&ponder->replies[cell], reply);
+        trace_log(LOG_DEBUG, "pondering: reply to {%d, %d} is {%d, %d}", cell / BOARD_COLUMNS_NB, cell % BOARD_COLUMNS_NB, reply / BOARD_COLUMNS_NB, reply % BOARD_COLUMNS_NB);
+    }
+
+    atomic_store(&ponder->searching, NO_MOVE);
+    return NULL;
+}
+#endif
+
+static void stop_ponder_thread(BotPonder *ponder)
+{
+#ifndef PLATFORM_WEB
+    if (ponder->is_thread_started) {
+        atomic_store(&ponder->cancel, true);
+        pthread_join(ponder->thread_id, NULL);
+        ponder->is_thread_started = false;
+    }
+#else
+    (void)ponder;
+#endif
+}
+
+/**
+ * Return the human move that leads from the pondered position to `pos`, or NO_MOVE if `pos` does not follow it
+ */
+static i32 get_pondered_move(const BotPonder *ponder, const Position *pos)
+{
+    const i32 human_side = ponder->pos.side_to_move;
+    const u16 new_tokens = pos->tokens[human_side] & ~ponder->pos.tokens[human_side];
+    if (count_bits(new_tokens) != 1) {
+        return NO_MOVE;
+    }
+
+    const i32 cell = __builtin_ctz(new_tokens);
+    Position next = ponder->pos;
+    position_make_move(&next, cell);
+    if (next.key != pos->key || next.tokens[0] != pos->tokens[0] || next.tokens[1] != pos->tokens[1]) {
+        return NO_MOVE;
+    }
+    return cell;
+}
+
+/**
+ * Start searching the bot move on the current board
+ * The search runs on a worker thread, poll_bot_search() gives its result once it is done
+ * On the web, or when the thread cannot be created, each call to poll_bot_search() searches for one slice instead
+ * With a `memory`, the search starts from what the earlier searches of the game learned, otherwise it starts cold
+ * The search takes over `ponder`, which can be NULL: it answers with the pondered reply if there is one,
+ * waits for it if it is being searched, and otherwise stops the pondering and searches
+ */
+BotSearch *start_bot_search(Tile board[][BOARD_COLUMNS_NB], const Tile stack_top_card, const BotSettings *settings, SearchMemory *memory, BotPonder *ponder)
+{
+    BotSearch *search;
+    ALLOC_VAR(search, BotSearch);
+    search->pos = position_from_board(board, stack_top_card.type, PLAYER2);
+    search->settings = *settings;
+    search->memory = memory;
+    atomic_init(&search->cancel, false);
+    atomic_init(&search->is_done, false);
+    search->best_cell = -1;
+
+    if (ponder != NULL) {
+        search->played = get_pondered_move(ponder, &search->pos);
+        if (search->played == NO_MOVE) {
+            stop_bot_ponder(ponder);
+        }
+        else {
+            search->ponder = ponder;
+            atomic_store(&ponder->played, search->played);
+            if (atomic_load(&ponder->searching) == search->played || atomic_load(&ponder->replies[search->played]) != NO_MOVE) {
+                trace_log(LOG_DEBUG, "pondering: the reply to the human move is ready or being searched");
+                return search;
+            }
+
+            // The pondering did not reach this move, its searches still warmed up the memory
+            stop_ponder_thread(ponder);
+            if (atomic_load(&ponder->replies[search->played]) != NO_MOVE) {
+                return search;
+            }
+            trace_log(LOG_DEBUG, "pondering: the human move was not searched yet");
+        }
+    }
+
+#ifndef PLATFORM_WEB
+    search->is_thread_started = pthread_create(&search->thread_id, NULL, run_bot_search_thread, search) == 0;
+    if (search->is_thread_started) {
+        return search;
+    }
+    trace_log(LOG_WARNING, "failed to start the bot search thread, searching on the main thread");
+#endif
+
+    if (search->settings.engine == BOT_ENGINE_MCTS) {
+        ALLOC_VAR(search->mcts, MctsSearch);
+        init_mcts_search(search->mcts, &search->pos, &search->settings, (search->memory != NULL) ? search->memory->mcts_tree : NULL, &search->cancel);
+        return search;
+    }
+    ALLOC_VAR(search->sliced, SlicedSearch);
+    start_sliced_search(search->sliced, &search->pos, &search->settings, search->memory);
+    return search;
+}
+
+/**
+ * Return true when the search is done, and then write the bot move in `pressed_tile`
+ */
+b32 poll_bot_search(BotSearch *search, Vec2i *pressed_tile)
+{
+    ASSERT(search != NULL, "The bot search should be started");
+
+    if ((search->sliced != NULL || search->mcts != NULL) && atomic_load_explicit(&search->is_done, memory_order_acquire) == false) {
+        run_bot_search_slice(search);
+    }
+
+    // Reply found by the pondering
+    if (search->ponder != NULL && atomic_load_explicit(&search->is_done, memory_order_acquire) == false) {
+        const i32 reply = atomic_load(&search->ponder->replies[search->played]);
+        if (reply != NO_MOVE) {
+            search->best_cell = reply;
+            atomic_store_explicit(&search->is_done, true, memory_order_release);
+        }
+    }
+
+    if (atomic_load_explicit(&search->is_done, memory_order_acquire) == false) {
+        return false;
+    }
+    *pressed_tile = (Vec2i){search->best_cell / BOARD_COLUMNS_NB, search->best_cell % BOARD_COLUMNS_NB};
+    trace_log(LOG_DEBUG, "best move : {%d, %d}", pressed_tile->x, pressed_tile->y);
+    return true;
+}
+
+/**
+ * Stop the search if it is still running, wait for its thread and free it
+ */
+void stop_bot_search(BotSearch *search)
+{
+    if (search == NULL) {
+        return;
+    }
+
+    atomic_store_explicit(&search->cancel, true, memory_order_relaxed);
+#ifndef PLATFORM_WEB
+    if (search->is_thread_started) {
+        pthread_join(search->thread_id, NULL);
+    }
+#endif
+    stop_bot_ponder(search->ponder);
+    if (search->sliced != NULL) {
+        free_sliced_search(search->sliced);
+        free(search->sliced);
+    }
+    if (search->mcts != NULL) {
+        free_mcts_search(search->mcts);
+        free(search->mcts);
+    }
+    free(search);
+}
+
+/**
+ * Start searching the bot replies to the human moves during the human turn, the searches fill `memory`
+ * This function returns NULL when pondering is disabled or not available (web build)
+ * The memory must not be used by another search until the pondering is stopped or taken over by start_bot_search()
+ */
+BotPonder *start_bot_ponder(Tile board[][BOARD_COLUMNS_NB], const Tile stack_top_card, const BotSettings *settings, SearchMemory *memory)
+{
+#ifndef PLATFORM_WEB
+    if (settings->ponder == false || memory == NULL) {
+        return NULL;
+    }
+
+    BotPonder *ponder;
+    ALLOC_VAR(ponder, BotPonder);
+    ponder->pos = position_from_board(board, stack_top_card.type, PLAYER1);
+    ponder->settings = *settings;
+    ponder->memory = memory;
+    atomic_init(&ponder->cancel, false);
+    for (i32 cell = 0; cell < BOARD_CELLS_NB; cell++) {
+        atomic_init(&ponder->replies[cell], NO_MOVE);
+    }
+    atomic_init(&ponder->searching, NO_MOVE);
+    atomic_init(&ponder->played, NO_MOVE);
+
+    ponder->is_thread_started = pthread_create(&ponder->thread_id, NULL, run_bot_ponder_thread, ponder) == 0;
+    if (ponder->is_thread_started == false) {
+        trace_log(LOG_WARNING, "failed to start the pondering thread");
+        free(ponder);
+        return NULL;
+    }
+    return ponder;
+#else
+    (void)board;
+    (void)stack_top_card;
+    (void)settings;
+    (void)memory;
+    return NULL;
+#endif
+}
+
+/**
+ * Stop the pondering if it is still running, wait for its thread and free it
+ */
+void stop_bot_ponder(BotPonder *ponder)
+{
+    if (ponder == NULL) {
+        return;
+    }
+
+    stop_ponder_thread(ponder);
+    free(ponder);
+}
@@ -2,8 +2,12 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
-#include "game.h"
+#include "game_botbrain.h"
+
+// The time and node budgets are checked once every SEARCH_CHECK_INTERVAL nodes
+#define SEARCH_CHECK_INTERVAL 1024
 
 static i32 max(i32 a, i32 b)
 {
@@ -15,262 +19,1309 @@ static i32 min(i32 a, i32 b)
     return (a < b) ? a : b;
 }
 
-static i32 evaluate_line(const Tile board[][BOARD_COLUMNS_NB], i32 start_x, i32 start_y, i32 dx, i32 dy, TileType player)
+/**
+ * Play a move on the position of the search and update its evaluation
+ * This function returns the previous last discarded card, it has to be given back to search_unmake_move()
+ */
+TileType search_make_move(SearchContext *ctx, const i32 cell)
+{
+    evaluator_add_token(&ctx->eval, ctx->pos.side_to_move, cell);
+    return position_make_move(&ctx->pos, cell);
+}
+
+void search_unmake_move(SearchContext *ctx, const i32 cell, const TileType previous_last_card)
+{
+    position_unmake_move(&ctx->pos, cell, previous_last_card);
+    evaluator_remove_token(&ctx->eval, ctx->pos.side_to_move, cell);
+}
+
+/**
+ * Winning and losing scores depend on the depth of the end of the game from the root
+ * The transposition table stores them relative to the node instead, so they stay valid when the position is reached at another depth
+ */
+static i32 score_to_tt(i32 score, i32 depth)
+{
+    if (score >= SCORE_WIN_BOUND) {
+        return score + depth;
+    }
+    if (score <= -SCORE_WIN_BOUND) {
+        return score - depth;
+    }
+    return score;
+}
+
+static i32 score_from_tt(i32 score, i32 depth)
 {
-    i32 count_player = 0;
-    i32 count_opponent = 0;
-    i32 count_empty = 0;
+    if (score >= SCORE_WIN_BOUND) {
+        return score - depth;
+    }
+    if (score <= -SCORE_WIN_BOUND) {
+        return score + depth;
+    }
+    return score;
+}
 
-    // Determine who is the opponent
-    TileType opponent = (player == TOKEN_PLAYER1) ? TOKEN_PLAYER2 : TOKEN_PLAYER1;
+static b32 is_search_cancelled(const SearchContext *ctx)
+{
+    return ctx->cancel != NULL && atomic_load_explicit(ctx->cancel, memory_order_relaxed);
+}
 
-    // Count the number of empty tiles, player tokens, and AI tokens ON THE CURRENT LINE
-    for (i32 i = 0; i < 4; ++i) {
-        TileType type = board[start_x + i * dx][start_y + i * dy].type;
-        if (type == player) {
-            count_player++;
+/**
+ * Return true when the search has to stop because its time or node budget is exhausted, or because it has been cancelled
+ * The threads of a parallel search share their node count and stop together
+ */
+static b32 is_search_budget_exhausted(SearchContext *ctx)
+{
+    if (ctx->shared == NULL) {
+        if (ctx->settings->node_budget != 0 && ctx->nodes >= ctx->settings->node_budget) {
+            ctx->stop = true;
         }
-        else if (type == opponent) {
-            count_opponent++;
+        else if ((ctx->nodes % SEARCH_CHECK_INTERVAL) == 0 && (get_precise_time() >= ctx->deadline || is_search_cancelled(ctx))) {
+            ctx->stop = true;
         }
-        else if (type == EMPTY_TILE) {
-            count_empty++;
+        return ctx->stop;
+    }
+
+    if ((ctx->nodes % SEARCH_CHECK_INTERVAL) == 0) {
+        const u64 nodes = atomic_fetch_add_explicit(&ctx->shared->nodes, SEARCH_CHECK_INTERVAL, memory_order_relaxed) + SEARCH_CHECK_INTERVAL;
+        if ((ctx->settings->node_budget != 0 && nodes >= ctx->settings->node_budget) || get_precise_time() >= ctx->deadline || is_search_cancelled(ctx)) {
+            atomic_store_explicit(&ctx->shared->stop, true, memory_order_relaxed);
         }
     }
+    if (atomic_load_explicit(&ctx->shared->stop, memory_order_relaxed)) {
+        ctx->stop = true;
+    }
+#ifndef PLATFORM_WEB
+    // A cutoff in a split point above cancels the subtree
+    if (ctx->split != NULL && is_split_cancelled(ctx->split)) {
+        ctx->stop = true;
+    }
+#endif
+    return ctx->stop;
+}
+
+/**
+ * Key of the node in the transposition table
+ * With settings->canonical_tt, equivalent positions share their entry: the key is the one of the canonical position,
+ * and `symmetry` maps the cells of the node to the cells of the canonical position, for the best move stored in the entry
+ */
+static u64 get_tt_key(const SearchContext *ctx, i32 *symmetry)
+{
+    if (ctx->settings->canonical_tt) {
+        return position_canonical_key(&ctx->pos, symmetry);
+    }
+    *symmetry = 0;
+    return ctx->pos.key;
+}
+
+static i32 move_to_tt(const i32 cell, const i32 symmetry)
+{
+    return (cell == NO_MOVE) ? NO_MOVE : symmetry_cells[symmetry][cell];
+}
+
+static i32 move_from_tt(const i32 cell, const i32 symmetry)
+{
+    return (cell == NO_MOVE) ? NO_MOVE : symmetry_cells[symmetry_inverse[symmetry]][cell];
+}
+
+/**
+ * An entry whose depth covers all the uncovered cards comes from a search that reached the end of the game everywhere
+ * Otherwise it may come from a search cut by its depth limit, in a deeper iteration or in another thread, and so does the score that uses it
+ */
+static void mark_if_depth_limited(SearchContext *ctx, const TTEntry *entry)
+{
+    const i32 uncovered = BOARD_CELLS_NB - count_bits(ctx->pos.tokens[0] | ctx->pos.tokens[1]);
+    if (entry->depth < uncovered) {
+        ctx->depth_limited = true;
+    }
+}
 
-    if (count_player == 4) {
-        return 100; // Certain victory
+/**
+ * Convert an exact result of the endgame solver into a search score, for the side to move at `depth`
+ */
+static i32 endgame_score(const EndgameResult *result, const i32 depth)
+{
+    switch (result->outcome) {
+        case OUTCOME_WIN:
+            return SCORE_WIN - (depth + result->distance);
+        case OUTCOME_LOSS:
+            return (depth + result->distance) - SCORE_WIN;
+        case OUTCOME_DRAW:
+            return 0;
     }
-    else if (count_opponent == 4) {
-        return -100; // Certain defeat
+    UNREACHABLE();
+    return 0;
+}
+
+/**
+ * Nodes left to the solver by the node budget of the search, 0 for no limit
+ */
+static u64 get_endgame_node_budget(const SearchContext *ctx)
+{
+    const u64 node_budget = ctx->settings->node_budget;
+    if (node_budget == 0) {
+        return 0;
     }
-    else if (count_player == 3 && count_empty == 1) {
-        return 10;
+    const u64 nodes = (ctx->shared != NULL) ? atomic_load_explicit(&ctx->shared->nodes, memory_order_relaxed) : ctx->nodes;
+    return (nodes < node_budget) ? node_budget - nodes : 1;
+}
+
+/**
+ * Deadline of a solve that starts now, `deadline` bounded by ctx->endgame_time
+ */
+static f64 get_endgame_deadline(const SearchContext *ctx, const f64 deadline)
+{
+    if (ctx->endgame_time == 0) {
+        return deadline;
     }
-    else if (count_player == 2 && count_empty == 2) {
-        return 5;
+    const f64 solve_deadline = get_precise_time() + ctx->endgame_time;
+    return (solve_deadline < deadline) ? solve_deadline : deadline;
+}
+
+/**
+ * Solve the node exactly when at most ctx->endgame_threshold cards are still uncovered
+ * The score is given from the point of view of the side to move and is stored in the transposition table, so other paths to the node reuse it
+ * This function returns false if the node is not an endgame, or if the solver ran out of time (ctx->stop is then set)
+ * A solve cut by ctx->endgame_time before the deadline disables the solver instead, and the node is searched like the others
+ */
+static b32 solve_endgame_node(SearchContext *ctx, const i32 depth, i32 *score)
+{
+    const Position *pos = &ctx->pos;
+    const i32 uncovered = BOARD_CELLS_NB - count_bits(pos->tokens[0] | pos->tokens[1]);
+    if (uncovered > ctx->endgame_threshold) {
+        return false;
     }
-    else if (count_opponent == 3 && count_empty == 1) {
-        return -10; // Block the opponent
+
+    // A search that reached the end of the game everywhere is as good as the solver
+    i32 symmetry;
+    const u64 tt_key = get_tt_key(ctx, &symmetry);
+    TTEntry entry;
+    if (tt_probe(ctx->tt, tt_key, &entry) && entry.bound == BOUND_EXACT && entry.depth >= uncovered) {
+        *score = score_from_tt(entry.score, depth);
+        return true;
     }
-    else if (count_opponent == 2 && count_empty == 2) {
-        return -5; // Anticipate blocking the opponent
+
+    const EndgameResult result = solve_endgame(pos, get_endgame_deadline(ctx, ctx->deadline), get_endgame_node_budget(ctx), ctx->cancel);
+    ctx->nodes += result.nodes;
+    if (!result.is_complete) {
+        if (ctx->endgame_time != 0 && get_precise_time() < ctx->deadline) {
+            // The node and cancel budgets are checked again by the next node
+            trace_log(LOG_DEBUG, "endgame solve cut after %llu nodes, searching without the solver", result.nodes);
+            ctx->endgame_threshold = 0;
+            return false;
+        }
+        ctx->stop = true;
+        return false;
     }
-    return 1;
+
+    *score = endgame_score(&result, depth);
+    tt_store(ctx->tt, tt_key, uncovered, BOUND_EXACT, score_to_tt(*score, depth), move_to_tt(result.best_cell, symmetry));
+    return true;
 }
 
-static i32 evaluate_square(const Tile board[][BOARD_COLUMNS_NB], i32 start_x, i32 start_y, TileType player)
+// Move ordering scores, each stage is tried before the next one
+#define ORDER_TT_MOVE (1 << 30)
+#define ORDER_WIN (1 << 29)
+#define ORDER_BLOCK (1 << 28)
+#define ORDER_KILLER_1 (1 << 27)
+#define ORDER_KILLER_2 (1 << 26)
+#define ORDER_HISTORY_MAX ((1 << 26) - 1)
+
+/**
+ * Fill the move list of a node and score each move:
+ * 1. the best move stored in the transposition table
+ * 2. the moves that win immediately, then the moves that cover a cell the opponent needs to win
+ * 3. the killer moves of this ply, then the other moves by history score
+ * Without move ordering, the moves keep the board order
+ */
+static void order_moves(const SearchContext *ctx, const u16 moves, const i32 tt_move, const i32 depth, MoveList *list)
 {
-    i32 count_player = 0;
-    i32 count_opponent = 0;
-    i32 count_empty = 0;
+    const Position *pos = &ctx->pos;
+    const u16 player_tokens = pos->tokens[pos->side_to_move];
+    const u16 opponent_tokens = pos->tokens[pos->side_to_move ^ 1];
 
-    // Determine who is the opponent
-    TileType opponent = (player == TOKEN_PLAYER1) ? TOKEN_PLAYER2 : TOKEN_PLAYER1;
+    list->count = 0;
+    for (u16 remaining = moves; remaining != 0; remaining &= remaining - 1) {
+        const i32 cell = __builtin_ctz(remaining);
+        i32 score = 0;
 
-    // Count the number of empty tiles, player tokens, and AI tokens ON THE CURRENT 2x2 SQUARE
-    for (i32 dx = 0; dx < 2; ++dx) {
-        for (i32 dy = 0; dy < 2; ++dy) {
-            TileType type = board[start_x + dx][start_y + dy].type;
-            if (type == player) {
-                count_player++;
+        if (ctx->settings->move_ordering) {
+            if (cell == tt_move) {
+                score = ORDER_TT_MOVE;
             }
-            else if (type == opponent) {
-                count_opponent++;
+            else if (is_winning_cell(player_tokens | CELL_BIT(cell), cell)) {
+                score = ORDER_WIN;
             }
-            else if (type == EMPTY_TILE) {
-                count_empty++;
+            else if (is_winning_cell(opponent_tokens | CELL_BIT(cell), cell)) {
+                score = ORDER_BLOCK;
+            }
+            else if (cell == ctx->killers[depth][0]) {
+                score = ORDER_KILLER_1;
+            }
+            else if (cell == ctx->killers[depth][1]) {
+                score = ORDER_KILLER_2;
+            }
+            else {
+                score = (i32)min((i32)ctx->history[pos->side_to_move][cell], ORDER_HISTORY_MAX);
             }
         }
-    }
 
-    if (count_player == 4) {
-        return 100; // Make the AI prioritize winning moves
-    }
-    else if (count_opponent == 4) {
-        return -100; // Make the AI avoid losing moves
-    }
-    else if (count_player == 3 && count_empty == 1) {
-        return 10; // Encourage moves that set up future wins
+        list->cells[list->count] = (u8)cell;
+        list->scores[list->count] = score;
+        list->count++;
     }
-    else if (count_player == 2 && count_empty == 2) {
-        return 5; // Encourage moves that make good positions
-    }
-    else if (count_opponent == 3 && count_empty == 1) {
-        return -10; // Encourage blocking opponent's immediate win
+}
+
+/**
+ * Return the move at `index`, after moving the best remaining move there (selection sort, one step per move tried)
+ * Equal scores keep the board order
+ */
+static i32 pick_next_move(MoveList *list, const i32 index)
+{
+    i32 best_index = index;
+    for (i32 i = index + 1; i < list->count; i++) {
+        if (list->scores[i] > list->scores[best_index]) {
+            best_index = i;
+        }
     }
-    else if (count_opponent == 2 && count_empty == 2) {
-        return -5; // Encourage moves that block opponent's potential threats
+
+    const u8 cell = list->cells[best_index];
+    const i32 score = list->scores[best_index];
+    for (i32 i = best_index; i > index; i--) {
+        list->cells[i] = list->cells[i - 1];
+        list->scores[i] = list->scores[i - 1];
     }
-    return 1; // If we put 0, there is an error
+    list->cells[index] = cell;
+    list->scores[index] = score;
+    return cell;
 }
 
 /**
- * This function evaluates all the lines and columns of the board and adds or subtracts the score
- * The score thus corresponds to the "score of the board, is it a good board or not for the AI"
- * This function returns a score associated with a board
+ * Remember a move that caused a cutoff, it will be tried early in the sibling nodes
  */
-static i32 evaluate_board(const Tile board[][BOARD_COLUMNS_NB], TileType player)
+static void record_cutoff(SearchContext *ctx, const i32 depth, const i32 cell)
 {
-    i32 board_score = 0;
+    const i32 remaining_depth = ctx->max_depth - depth;
+    ctx->history[ctx->pos.side_to_move][cell] += remaining_depth * remaining_depth;
 
-    // Check lines and columns
-    for (i32 i = 0; i < BOARD_ROWS_NB; ++i) {
-        board_score += evaluate_line(board, i, 0, 0, 1, player);
-        board_score += evaluate_line(board, 0, i, 1, 0, player);
+    if (ctx->killers[depth][0] != cell) {
+        ctx->killers[depth][1] = ctx->killers[depth][0];
+        ctx->killers[depth][0] = (u8)cell;
     }
+}
 
-    // Check diagonals
-    board_score += evaluate_line(board, 0, 0, 1, 1, player);
-    board_score += evaluate_line(board, 0, 3, 1, -1, player);
+// Nodes with at least this remaining depth can be split between the threads
+#define SPLIT_MIN_DEPTH 4
 
-    // Check squares (4 possible configurations)
-    for (i32 i = 0; i < BOARD_ROWS_NB - 1; ++i) {
-        for (i32 j = 0; j < BOARD_COLUMNS_NB - 1; ++j) {
-            board_score += evaluate_square(board, i, j, player);
-        }
-    }
+/**
+ * Young brothers wait: once the first child of a node has been searched, its other children can be searched in parallel
+ */
+static b32 can_split(const SearchContext *ctx, const i32 remaining_depth, const i32 siblings_nb)
+{
+    return ctx->shared != NULL && ctx->shared->scheduler != NULL && remaining_depth >= SPLIT_MIN_DEPTH && siblings_nb >= 2;
+}
 
-    return board_score;
+/**
+ * Hand the moves of `list` after the first one to the work stealing threads, and wait for their results
+ * This function returns the move that caused a cutoff, or NO_MOVE
+ */
+static i32 split_node(SearchContext *ctx, MoveList *list, const i32 depth, const b32 is_maximizing, i32 *alpha, i32 *beta, i32 *best, i32 *best_move)
+{
+#ifndef PLATFORM_WEB
+    u8 cells[BOARD_CELLS_NB];
+    i32 cells_nb = 0;
+    for (i32 k = 1; k < list->count; k++) {
+        cells[cells_nb++] = (u8)pick_next_move(list, k);
+    }
+    return search_split(ctx, cells, cells_nb, depth, is_maximizing, alpha, beta, best, best_move);
+#else
+    // The web build has no helper threads, so can_split() is always false
+    (void)ctx;
+    (void)list;
+    (void)depth;
+    (void)is_maximizing;
+    (void)alpha;
+    (void)beta;
+    (void)best;
+    (void)best_move;
+    UNREACHABLE();
+    return NO_MOVE;
+#endif
 }
 
 /**
  * Minimax function to evaluate the best move for the AI.
  * This function returns a score for the current situation of the game board.
- * It evaluates the score of the current board,
+ * The AI is the side to move at the root, it is the maximizing player.
+ * When the budget is exhausted, ctx->stop is set and the returned score is meaningless
  */
-#define MAX_DEPTH 16
-static i32 minimax(Tile board[][BOARD_COLUMNS_NB], TileType stack_top_card, i32 depth, b32 is_maximizing, i32 alpha, i32 beta)
+i32 minimax(SearchContext *ctx, i32 last_cell, i32 depth, b32 is_maximizing, i32 alpha, i32 beta)
 {
-    i32 board_score_bot = evaluate_board(board, TOKEN_PLAYER2);
-    i32 board_score_player1 = evaluate_board(board, TOKEN_PLAYER1);
+    Position *pos = &ctx->pos;
+    ctx->nodes++;
+    if (is_search_budget_exhausted(ctx)) {
+        return 0;
+    }
 
-    // CASE 1: The current game terrain is critical (immediate victory or defeat) or the board is full
+    // CASE 1: The game is over (full board, four tokens aligned, or the next player cannot play)
     //      => We return, so we stop looking at all possible positions after
+    // We modify the score according to the number of moves to reach this board
+    u16 moves;
+    const PositionOutcome outcome = position_outcome(pos, last_cell, &moves);
+    if (outcome == POSITION_DRAW) {
+        return 0;
+    }
+    if (outcome == POSITION_LOST) {
+        if (is_maximizing) {
+            return depth - SCORE_WIN; // Prefer slow defeats
+        }
+        return SCORE_WIN - depth; // Prefer quick victories
+    }
 
-    // We modify the board score according to the number of moves to reach this board
-    if (board_score_bot >= 100) {
-        // Here we return a very good score if the depth is low
-        return 100 - depth * 3; // Prefer quick victories
+    // With few cards left, the end of the game is solved exactly instead of being evaluated
+    i32 endgame_value;
+    if (solve_endgame_node(ctx, depth, &endgame_value)) {
+        return is_maximizing ? endgame_value : -endgame_value;
     }
-    if (board_score_player1 >= 100) {
-        return depth - 100 * 3; // Prefer slow defeats
+    if (ctx->stop) {
+        return 0;
     }
 
-    // If the maximum depth is reached or if there are no more possible moves
-    if (depth >= MAX_DEPTH || is_board_full(board)) {
+    // If the maximum depth of this iteration is reached
+    if (depth >= ctx->max_depth) {
+        ctx->depth_limited = true;
         // Return the difference of scores to evaluate the current position.
         // This allows us to evaluate the quality of the position beyond terminal conditions.
-        return board_score_bot - board_score_player1;
+        return evaluator_score(&ctx->eval, &ctx->pos, ctx->root_side);
+    }
+
+    // If this position has already been searched deep enough, reuse the result or at least narrow the window
+    // The table is shared with the negamax search, its scores are given from the point of view of the side to move
+    const i32 remaining_depth = ctx->max_depth - depth;
+    i32 symmetry;
+    const u64 tt_key = get_tt_key(ctx, &symmetry);
+    TTEntry entry;
+    i32 tt_move = NO_MOVE;
+    if (tt_probe(ctx->tt, tt_key, &entry)) {
+        tt_move = move_from_tt(entry.best_move, symmetry);
+        if (entry.depth >= remaining_depth) {
+            mark_if_depth_limited(ctx, &entry);
+            const i32 tt_score = is_maximizing ? score_from_tt(entry.score, depth) : -score_from_tt(entry.score, depth);
+            if (entry.bound == BOUND_EXACT) {
+                return tt_score;
+            }
+            else if ((entry.bound == BOUND_LOWER) == is_maximizing) {
+                alpha = max(alpha, tt_score);
+            }
+            else {
+                beta = min(beta, tt_score);
+            }
+            if (beta <= alpha) {
+                return tt_score;
+            }
+        }
     }
+    const i32 original_alpha = alpha;
+    const i32 original_beta = beta;
+    i32 best_move = NO_MOVE;
 
     // CASE 2: The current terrain is not critical, so we will test all the following possible moves recursively
+    MoveList list;
+    order_moves(ctx, moves, tt_move, depth, &list);
 
     // If it is the AI's turn, we go into positive mode
+    i32 best;
     if (is_maximizing) {
         // It's the AI's turn (maximizing player)
-        i32 best = -INT_MAX; // Initialize the best score to the smallest possible value
-
-        // Browse all the board squares to find the best move
-        for (i32 i = 0; i < BOARD_ROWS_NB; i++) {
-            for (i32 j = 0; j < BOARD_COLUMNS_NB; j++) {
-                if (board[i][j].type != TOKEN_PLAYER1 && board[i][j].type != TOKEN_PLAYER2) {
-                    if (have_common_color(board[i][j].type, stack_top_card)) {
-                        TileType original = board[i][j].type;
-                        board[i][j].type = TOKEN_PLAYER2;
-
-                        // Recursive call to minimax to evaluate this position, changing the player
-                        // We pass `false` to indicate that it will be the minimizing player's turn next.
-                        best = max(best, minimax(board, original, depth + 1, false, alpha, beta));
-                        board[i][j].type = original;
-
-                        // Update alpha and perform an alpha-beta pruning if necessary
-                        // If the best score obtained is higher than beta, we can stop considering other moves (pruning).
-                        alpha = max(alpha, best);
-                        if (beta <= alpha) {
-                            // Perform an alpha-beta pruning
-                            break;
-                        }
-                    }
+        best = -INT_MAX; // Initialize the best score to the smallest possible value
+
+        // Browse all the playable cells, most promising first, to find the best move
+        for (i32 k = 0; k < list.count; k++) {
+            // The first move has been searched without cutoff, the other ones can be searched in parallel
+            if (k == 1 && can_split(ctx, remaining_depth, list.count - 1)) {
+                const i32 cutoff_cell = split_node(ctx, &list, depth, is_maximizing, &alpha, &beta, &best, &best_move);
+                if (ctx->stop) {
+                    return 0;
+                }
+                if (cutoff_cell != NO_MOVE) {
+                    record_cutoff(ctx, depth, cutoff_cell);
                 }
+                break;
+            }
+
+            const i32 cell = pick_next_move(&list, k);
+            const TileType previous_last_card = search_make_move(ctx, cell);
+
+            // Recursive call to minimax to evaluate this position, changing the player
+            // We pass `false` to indicate that it will be the minimizing player's turn next.
+            const i32 score = minimax(ctx, cell, depth + 1, false, alpha, beta);
+            search_unmake_move(ctx, cell, previous_last_card);
+            if (ctx->stop) {
+                return 0;
+            }
+            if (score > best) {
+                best = score;
+                best_move = cell;
+            }
+
+            // Update alpha and perform an alpha-beta pruning if necessary
+            // If the best score obtained is higher than beta, we can stop considering other moves (pruning).
+            alpha = max(alpha, best);
+            if (beta <= alpha) {
+                // Perform an alpha-beta pruning
+                record_cutoff(ctx, depth, cell);
+                break;
             }
         }
-        return best;
     }
 
     // Otherwise, we go into negative mode
     else {
         // It's the opponent's turn (minimizing player)
-        i32 best = INT_MAX; // Initialize the best score to the largest possible value
-
-        // Browse all the board squares to find the best move
-        for (i32 i = 0; i < BOARD_ROWS_NB; i++) {
-            for (i32 j = 0; j < BOARD_COLUMNS_NB; j++) {
-                if (board[i][j].type != TOKEN_PLAYER1 && board[i][j].type != TOKEN_PLAYER2) {
-                    if (have_common_color(board[i][j].type, stack_top_card)) {
-                        TileType original = board[i][j].type;
-                        board[i][j].type = TOKEN_PLAYER1;
-
-                        // Recursive call to minimax to evaluate this position, changing the player
-                        // We pass `true` to indicate that it will be the maximizing player's turn next.
-                        best = min(best, minimax(board, original, depth + 1, true, alpha, beta));
-                        board[i][j].type = original;
-
-                        // Update beta and perform an alpha-beta pruning if necessary
-                        // If the best score obtained is lower than alpha, we can stop considering other moves (pruning).
-                        beta = min(beta, best);
-                        if (beta <= alpha)
-                            break; // Perform an alpha-beta pruning
-                    }
+        best = INT_MAX; // Initialize the best score to the largest possible value
+
+        // Browse all the playable cells, most promising first, to find the best move
+        for (i32 k = 0; k < list.count; k++) {
+            if (k == 1 && can_split(ctx, remaining_depth, list.count - 1)) {
+                const i32 cutoff_cell = split_node(ctx, &list, depth, is_maximizing, &alpha, &beta, &best, &best_move);
+                if (ctx->stop) {
+                    return 0;
                 }
+                if (cutoff_cell != NO_MOVE) {
+                    record_cutoff(ctx, depth, cutoff_cell);
+                }
+                break;
+            }
+
+            const i32 cell = pick_next_move(&list, k);
+            const TileType previous_last_card = search_make_move(ctx, cell);
+
+            // Recursive call to minimax to evaluate this position, changing the player
+            // We pass `true` to indicate that it will be the maximizing player's turn next.
+            const i32 score = minimax(ctx, cell, depth + 1, true, alpha, beta);
+            search_unmake_move(ctx, cell, previous_last_card);
+            if (ctx->stop) {
+                return 0;
+            }
+            if (score < best) {
+                best = score;
+                best_move = cell;
+            }
+
+            // Update beta and perform an alpha-beta pruning if necessary
+            // If the best score obtained is lower than alpha, we can stop considering other moves (pruning).
+            beta = min(beta, best);
+            if (beta <= alpha) {
+                record_cutoff(ctx, depth, cell);
+                break; // Perform an alpha-beta pruning
             }
         }
-        return best;
     }
+
+    // Save the result, it is exact only if it is inside the search window
+    BoundType bound = BOUND_EXACT;
+    if (best <= original_alpha) {
+        bound = is_maximizing ? BOUND_UPPER : BOUND_LOWER;
+    }
+    else if (best >= original_beta) {
+        bound = is_maximizing ? BOUND_LOWER : BOUND_UPPER;
+    }
+    tt_store(ctx->tt, tt_key, remaining_depth, bound, score_to_tt(is_maximizing ? best : -best, depth), move_to_tt(best_move, symmetry));
+    return best;
 }
 
 /**
- * This function takes the game board and the stack as arguments, it returns the best position for the next move
- * This function returns the coordinates of a tile on the board
+ * Principal variation search, in negamax form: the score is always given from the point of view of the side to move
+ * The first move is searched with the full window, the next ones with a null window that only proves they are not better
+ * A move that fails high is searched again with the full window to get its real score
+ * When the budget is exhausted, ctx->stop is set and the returned score is meaningless
  */
-static Vec2i find_best_move(Tile board[][BOARD_COLUMNS_NB], TileType stack_top_card)
+i32 negascout(SearchContext *ctx, i32 last_cell, i32 depth, i32 alpha, i32 beta)
 {
-    i32 best_value = -INT_MAX;
-    Vec2i best_move = {-1, -1};
+    Position *pos = &ctx->pos;
+    ctx->nodes++;
+    if (is_search_budget_exhausted(ctx)) {
+        return 0;
+    }
+
+    u16 moves;
+    const PositionOutcome outcome = position_outcome(pos, last_cell, &moves);
+    if (outcome == POSITION_DRAW) {
+        return 0;
+    }
+    if (outcome == POSITION_LOST) {
+        return depth - SCORE_WIN; // Prefer slow defeats, and so quick victories for the opponent
+    }
+
+    i32 endgame_value;
+    if (solve_endgame_node(ctx, depth, &endgame_value)) {
+        return endgame_value;
+    }
+    if (ctx->stop) {
+        return 0;
+    }
 
-    // We browse each card of the board, if it is valid, then we launch the minmax function to know the score associated with this tile
-    for (i32 i = 0; i < BOARD_ROWS_NB; i++) {
-        for (i32 j = 0; j < BOARD_COLUMNS_NB; j++) {
-            if (board[i][j].type != TOKEN_PLAYER1 && board[i][j].type != TOKEN_PLAYER2) {
-                if (have_common_color(board[i][j].type, stack_top_card)) {
-                    trace_log(LOG_DEBUG, "\nChecking tile {row: %d, col: %d} score...", j + 1, i + 1);
-                    TileType original = board[i][j].type;
+    if (depth >= ctx->max_depth) {
+        ctx->depth_limited = true;
+        return evaluator_score(&ctx->eval, pos, pos->side_to_move);
+    }
 
-                    // Act as if the AI had played on this square, and analyze the situation with minimax
-                    board[i][j].type = TOKEN_PLAYER2;
+    const i32 remaining_depth = ctx->max_depth - depth;
+    i32 symmetry;
+    const u64 tt_key = get_tt_key(ctx, &symmetry);
+    TTEntry entry;
+    i32 tt_move = NO_MOVE;
+    if (tt_probe(ctx->tt, tt_key, &entry)) {
+        tt_move = move_from_tt(entry.best_move, symmetry);
+        if (entry.depth >= remaining_depth) {
+            mark_if_depth_limited(ctx, &entry);
+            const i32 tt_score = score_from_tt(entry.score, depth);
+            if (entry.bound == BOUND_EXACT) {
+                return tt_score;
+            }
+            else if (entry.bound == BOUND_LOWER) {
+                alpha = max(alpha, tt_score);
+            }
+            else {
+                beta = min(beta, tt_score);
+            }
+            if (beta <= alpha) {
+                return tt_score;
+            }
+        }
+    }
+    const i32 original_alpha = alpha;
 
-                    // This function will associate a score with a playable tile
-                    i32 move_value = minimax(board, original, 0, false, -INT_MAX, INT_MAX); // Change stack_top_card to original
-                    trace_log(LOG_DEBUG, "    > The move value for this tile is %d", move_value);
-                    board[i][j].type = original;
+    MoveList list;
+    order_moves(ctx, moves, tt_move, depth, &list);
 
-                    if (move_value > best_value) {
-                        best_move.x = i;
-                        best_move.y = j;
-                        best_value = move_value;
-                    }
+    i32 best = -INT_MAX;
+    i32 best_move = NO_MOVE;
+    for (i32 k = 0; k < list.count; k++) {
+        // The first move has been searched with the full window, the null window searches of the other ones can run in parallel
+        if (k == 1 && can_split(ctx, remaining_depth, list.count - 1)) {
+            const i32 cutoff_cell = split_node(ctx, &list, depth, true, &alpha, &beta, &best, &best_move);
+            if (ctx->stop) {
+                return 0;
+            }
+            if (cutoff_cell != NO_MOVE) {
+                record_cutoff(ctx, depth, cutoff_cell);
+            }
+            break;
+        }
+
+        const i32 cell = pick_next_move(&list, k);
+        const TileType previous_last_card = search_make_move(ctx, cell);
+
+        i32 score;
+        if (k == 0) {
+            score = -negascout(ctx, cell, depth + 1, -beta, -alpha);
+        }
+        else {
+            score = -negascout(ctx, cell, depth + 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta && !ctx->stop) {
+                score = -negascout(ctx, cell, depth + 1, -beta, -alpha);
+            }
+        }
+        search_unmake_move(ctx, cell, previous_last_card);
+        if (ctx->stop) {
+            return 0;
+        }
+
+        if (score > best) {
+            best = score;
+            best_move = cell;
+        }
+        alpha = max(alpha, best);
+        if (alpha >= beta) {
+            record_cutoff(ctx, depth, cell);
+            break;
+        }
+    }
+
+    BoundType bound = BOUND_EXACT;
+    if (best <= original_alpha) {
+        bound = BOUND_UPPER;
+    }
+    else if (best >= beta) {
+        bound = BOUND_LOWER;
+    }
+    tt_store(ctx->tt, tt_key, remaining_depth, bound, score_to_tt(best, depth), move_to_tt(best_move, symmetry));
+    return best;
+}
+
+/**
+ * Search one root move with the window (alpha, +infinity) and return its score from the point of view of the bot
+ * A score that is not above alpha is only an upper bound
+ */
+i32 search_root_move(SearchContext *ctx, const i32 cell, const i32 alpha)
+{
+    // Act as if the AI had played on this square, and analyze the situation with minimax
+    const TileType previous_last_card = search_make_move(ctx, cell);
+
+    // This function will associate a score with a playable tile
+    i32 move_value;
+    if (ctx->settings->algorithm == BOT_ALGORITHM_PVS) {
+        if (alpha == -INT_MAX) {
+            move_value = -negascout(ctx, cell, 0, -INT_MAX, INT_MAX);
+        }
+        else {
+            move_value = -negascout(ctx, cell, 0, -alpha - 1, -alpha);
+            if (move_value > alpha && !ctx->stop) {
+                move_value = -negascout(ctx, cell, 0, -INT_MAX, -alpha);
+            }
+        }
+    }
+    else {
+        move_value = minimax(ctx, cell, 0, false, alpha, INT_MAX);
+    }
+    search_unmake_move(ctx, cell, previous_last_card);
+    return move_value;
+}
+
+/**
+ * Search every root move at the depth of the current iteration
+ * The previous best move is searched first, so that the alpha-beta pruning is efficient from the start
+ * With minimax, every root move gets an exact score. With PVS, the moves after the first one only get a bound unless they are better
+ * This function returns false if the iteration has been interrupted by the budget
+ */
+static b32 search_root(SearchContext *ctx, i32 *best_cell, i32 *best_value)
+{
+#ifndef PLATFORM_WEB
+    if (ctx->threads != NULL && ctx->settings->parallelism == BOT_PARALLEL_ROOT_SPLIT) {
+        return search_root_parallel(ctx, best_cell, best_value);
+    }
+#endif
+
+    const u16 moves = position_legal_moves(&ctx->pos);
+    const i32 previous_best_cell = *best_cell;
+
+    i32 iteration_best_cell = previous_best_cell;
+    i32 iteration_best_value = -INT_MAX;
+
+    u16 remaining = moves & ~CELL_BIT(previous_best_cell);
+    i32 cell = previous_best_cell;
+    while (true) {
+        // The minimax window is kept open so every root move gets an exact score
+        const i32 alpha = (ctx->settings->algorithm == BOT_ALGORITHM_PVS) ? iteration_best_value : -INT_MAX;
+        const i32 move_value = search_root_move(ctx, cell, alpha);
+        if (ctx->stop) {
+            return false;
+        }
+        trace_log(LOG_DEBUG, "    > tile {row: %d, col: %d}: %d", cell % BOARD_COLUMNS_NB + 1, cell / BOARD_COLUMNS_NB + 1, move_value);
+
+        if (move_value > iteration_best_value) {
+            iteration_best_cell = cell;
+            iteration_best_value = move_value;
+        }
+
+        if (remaining == 0) {
+            break;
+        }
+        cell = __builtin_ctz(remaining);
+        remaining &= remaining - 1;
+    }
+
+    *best_cell = iteration_best_cell;
+    *best_value = iteration_best_value;
+    return true;
+}
+
+/**
+ * Move played until the first iteration of the search completes: the first legal move
+ */
+static i32 get_fallback_move(const Position *pos)
+{
+    const u16 moves = position_legal_moves(pos);
+    ASSERT(moves != 0, "The bot should have a move to play");
+    return __builtin_ctz(moves);
+}
+
+/**
+ * Iterative deepening: search the root at depth start_depth, start_depth + 1... until the budget is exhausted
+ * The best move of the last complete iteration is always ready, so the search can be interrupted at any time
+ * This function returns the cell of the best move, the depth and the score of the last complete iteration are written in `completed_depth` and `completed_score`
+ */
+i32 search_iterative(SearchContext *ctx, const i32 start_depth, i32 *completed_depth, i32 *completed_score)
+{
+    i32 best_cell = get_fallback_move(&ctx->pos);
+    i32 best_value = 0;
+
+    for (i32 depth = start_depth; depth <= ctx->settings->max_depth; depth++) {
+        ctx->max_depth = depth;
+        ctx->depth_limited = false;
+
+        if (!search_root(ctx, &best_cell, &best_value)) {
+            trace_log(LOG_DEBUG, "depth %d interrupted after %llu nodes", depth, ctx->nodes);
+            break;
+        }
+        *completed_depth = depth;
+        *completed_score = best_value;
+        trace_log(LOG_DEBUG, "depth %d: best tile {row: %d, col: %d}, score %d, %llu nodes", depth, best_cell % BOARD_COLUMNS_NB + 1, best_cell / BOARD_COLUMNS_NB + 1, best_value, ctx->nodes);
+
+        // Deeper iterations would give the same result if the whole game tree has been searched, or if the result is already a forced win or loss
+        if (!ctx->depth_limited || best_value >= SCORE_WIN_BOUND || best_value <= -SCORE_WIN_BOUND) {
+            break;
+        }
+    }
+
+    return best_cell;
+}
+
+/**
+ * With few cards left, the solver plays perfectly without iterative deepening
+ * This function returns false if the root is not an endgame or if the solver gave up, otherwise the best move is written in `best_cell`
+ * The solver only gets half of the time and node budgets, so that the search can use the other half when it gives up
+ * It also stops after ctx->endgame_time, so that the sliced search never blocks for more than one slice
+ */
+static b32 solve_root_endgame(SearchContext *ctx, i32 *best_cell, i32 *completed_depth, i32 *completed_score)
+{
+    // The root children are at depth 0, so the root itself is at depth -1
+    const i32 uncovered = BOARD_CELLS_NB - count_bits(ctx->pos.tokens[0] | ctx->pos.tokens[1]);
+    if (uncovered > ctx->endgame_threshold) {
+        return false;
+    }
+
+    const f64 start_time = get_precise_time();
+    const u64 node_budget = get_endgame_node_budget(ctx);
+    const f64 deadline = get_endgame_deadline(ctx, start_time + (ctx->deadline - start_time) / 2);
+    const EndgameResult result = solve_endgame(&ctx->pos, deadline, (node_budget != 0) ? (node_budget + 1) / 2 : 0, ctx->cancel);
+    ctx->nodes += result.nodes;
+    if (result.is_complete) {
+        *best_cell = result.best_cell;
+        *completed_depth = result.distance;
+        *completed_score = endgame_score(&result, -1);
+        trace_log(LOG_DEBUG, "endgame solved: best tile {row: %d, col: %d}, outcome %d in %d plies, %llu nodes", result.best_cell % BOARD_COLUMNS_NB + 1, result.best_cell / BOARD_COLUMNS_NB + 1, result.outcome, result.distance, result.nodes);
+        return true;
+    }
+
+    // The nodes of the search are closer to the end of the game than the root, but the solver would most likely give up on them too
+    trace_log(LOG_DEBUG, "endgame solver interrupted after %llu nodes, searching instead", result.nodes);
+    ctx->endgame_threshold = 0;
+#ifndef PLATFORM_WEB
+    if (ctx->threads != NULL) {
+        for (i32 i = 0; i < ctx->threads->helpers_nb; i++) {
+            ctx->threads->helpers[i].endgame_threshold = 0;
+        }
+    }
+#endif
+    return false;
+}
+
+/**
+ * Find the best move of the root: solve it if it is an endgame, otherwise search it by iterative deepening
+ */
+static i32 find_best_move(SearchContext *ctx, i32 *completed_depth, i32 *completed_score)
+{
+    i32 best_cell;
+    if (solve_root_endgame(ctx, &best_cell, completed_depth, completed_score)) {
+        return best_cell;
+    }
+
+#ifndef PLATFORM_WEB
+    if (ctx->threads != NULL && ctx->settings->parallelism == BOT_PARALLEL_LAZY_SMP) {
+        return search_lazy_smp(ctx, completed_depth, completed_score);
+    }
+#endif
+    return search_iterative(ctx, 1, completed_depth, completed_score);
+}
+
+void init_bot_settings(BotSettings *settings)
+{
+    settings->engine = BOT_ENGINE_MINIMAX;
+    settings->time_budget = BOT_DEFAULT_TIME_BUDGET;
+    settings->node_budget = BOT_DEFAULT_NODE_BUDGET;
+    settings->max_depth = BOT_DEFAULT_MAX_DEPTH;
+    settings->tt_size_log2 = TT_DEFAULT_SIZE_LOG2;
+    settings->canonical_tt = false;
+    settings->move_ordering = true;
+    settings->endgame_threshold = BOT_DEFAULT_ENDGAME_THRESHOLD;
+    settings->threads = BOT_DEFAULT_THREADS;
+    settings->parallelism = BOT_PARALLEL_ROOT_SPLIT;
+    settings->algorithm = BOT_ALGORITHM_MINIMAX;
+    settings->reply_delay = BOT_DEFAULT_REPLY_DELAY;
+    settings->ponder = true;
+    settings->slice_time = BOT_DEFAULT_SLICE_TIME;
+    settings->playout_budget = BOT_DEFAULT_PLAYOUT_BUDGET;
+    settings->mcts_exploration = BOT_DEFAULT_MCTS_EXPLORATION;
+    settings->batched_playouts = false;
+    settings->mcts_arena_nodes = BOT_DEFAULT_MCTS_ARENA_NODES;
+    settings->network = NULL;
+}
+
+/**
+ * Allocate the search state that the bot keeps for a whole game
+ */
+SearchMemory *create_search_memory(const BotSettings *settings)
+{
+    SearchMemory *memory;
+    ALLOC_VAR(memory, SearchMemory);
+    tt_init(&memory->tt, settings->tt_size_log2);
+    memset(memory->killers, NO_MOVE, sizeof(memory->killers));
+    memory->root_ply = -1;
+    memory->mcts_tree = (settings->engine == BOT_ENGINE_MCTS) ? create_mcts_tree(settings) : NULL;
+    return memory;
+}
+
+void destroy_search_memory(SearchMemory *memory)
+{
+    if (memory == NULL) {
+        return;
+    }
+    tt_free(&memory->tt);
+    destroy_mcts_tree(memory->mcts_tree);
+    free(memory);
+}
+
+/**
+ * Prepare the memory for a search from a root with `root_ply` tokens on the board
+ * The killers are indexed by the depth from the root, so they move up by the number of plies played since the last search
+ * The history is halved at each new move, so the cutoffs of the current part of the game weigh more
+ */
+static void age_search_memory(SearchMemory *memory, const i32 root_ply)
+{
+    tt_new_search(&memory->tt);
+    if (root_ply == memory->root_ply) {
+        return;
+    }
+
+    const i32 shift = root_ply - memory->root_ply;
+    if (memory->root_ply < 0 || shift < 0 || shift >= MAX_PLY) {
+        memset(memory->killers, NO_MOVE, sizeof(memory->killers));
+    }
+    else {
+        memmove(memory->killers, memory->killers[shift], sizeof(memory->killers[0]) * (MAX_PLY - shift));
+        memset(memory->killers[MAX_PLY - shift], NO_MOVE, sizeof(memory->killers[0]) * shift);
+    }
+
+    for (i32 side = 0; side < 2; side++) {
+        for (i32 cell = 0; cell < BOARD_CELLS_NB; cell++) {
+            memory->history[side][cell] >>= 1;
+        }
+    }
+    memory->root_ply = root_ply;
+}
+
+/**
+ * Search the best move of the side to move within the budget of `settings`
+ * Another thread can stop the search early by setting `cancel`, the best move found so far is then returned
+ * The position is not modified, `cancel` and `stats` can be NULL
+ * This function returns the cell of the best move
+ */
+i32 search_best_move(const Position *pos, const BotSettings *settings, atomic_bool *cancel, SearchStats *stats)
+{
+    if (settings->engine == BOT_ENGINE_MCTS) {
+        return search_mcts(pos, settings, NULL, cancel, stats);
+    }
+
+    SearchMemory *memory = create_search_memory(settings);
+    const i32 best_cell = search_best_move_with_memory(pos, settings, memory, cancel, stats);
+    destroy_search_memory(memory);
+    return best_cell;
+}
+
+/**
+ * Prepare the context of a search of `pos` from what `memory` learned in the earlier searches
+ */
+static void init_search_context(SearchContext *ctx, const Position *pos, const BotSettings *settings, SearchMemory *memory)
+{
+    age_search_memory(memory, count_bits(pos->tokens[0] | pos->tokens[1]));
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->pos = *pos;
+    evaluator_init(&ctx->eval, pos, settings->network);
+    ctx->root_side = pos->side_to_move;
+    ctx->tt = &memory->tt;
+    ctx->settings = settings;
+    ctx->endgame_threshold = settings->endgame_threshold;
+    memcpy(ctx->killers, memory->killers, sizeof(ctx->killers));
+    memcpy(ctx->history, memory->history, sizeof(ctx->history));
+}
+
+static void save_search_memory(const SearchContext *ctx, SearchMemory *memory)
+{
+    memcpy(memory->killers, ctx->killers, sizeof(ctx->killers));
+    memcpy(memory->history, ctx->history, sizeof(ctx->history));
+}
+
+/**
+ * Same as search_best_move(), starting from the transposition table, killers and history left by the earlier searches of `memory`
+ * The memory is updated with what this search learned
+ */
+i32 search_best_move_with_memory(const Position *pos, const BotSettings *settings, SearchMemory *memory, atomic_bool *cancel, SearchStats *stats)
+{
+    if (settings->engine == BOT_ENGINE_MCTS) {
+        return search_mcts(pos, settings, memory->mcts_tree, cancel, stats);
+    }
+
+    SearchContext ctx;
+    init_search_context(&ctx, pos, settings, memory);
+    const TranspositionTable *tt = ctx.tt;
+
+    const f64 start_time = get_precise_time();
+    ctx.deadline = start_time + settings->time_budget;
+    ctx.cancel = cancel;
+
+#ifndef PLATFORM_WEB
+    SearchThreads threads;
+    if (settings->threads > 1) {
+        init_search_threads(&threads, &ctx, settings->threads - 1);
+    }
+#endif
+
+    i32 depth = 0;
+    i32 score = 0;
+    const i32 best_cell = find_best_move(&ctx, &depth, &score);
+
+    // Node counts of the calling thread, then of the helpers
+    u64 thread_nodes[BOT_MAX_THREADS] = {ctx.nodes};
+    i32 threads_nb = 1;
+    u64 total_nodes = ctx.nodes;
+#ifndef PLATFORM_WEB
+    if (ctx.threads != NULL) {
+        stop_search_threads(&threads);
+        for (i32 i = 0; i < threads.helpers_nb; i++) {
+            thread_nodes[threads_nb++] = threads.helpers[i].nodes;
+            total_nodes += threads.helpers[i].nodes;
+        }
+        free_search_threads(&threads);
+    }
+#endif
+
+    save_search_memory(&ctx, memory);
+
+    trace_log(LOG_DEBUG, "transposition table: %llu hits (%llu from earlier searches), %llu misses, %llu collisions, %llu stores", tt->hits, tt->reused, tt->misses, tt->collisions, tt->stores);
+
+    if (stats != NULL) {
+        stats->best_cell = best_cell;
+        stats->score = score;
+        stats->depth = depth;
+        stats->nodes = total_nodes;
+        stats->threads = threads_nb;
+        memcpy(stats->thread_nodes, thread_nodes, sizeof(thread_nodes));
+        stats->time = get_precise_time() - start_time;
+        stats->tt_hits = tt->hits;
+        stats->tt_reused = tt->reused;
+        stats->tt_misses = tt->misses;
+        stats->tt_collisions = tt->collisions;
+    }
+
+    return best_cell;
+}
+
+// Nodes, those of the endgame solver included, between two looks at the clock in a sliced search
+#define SLICE_CHECK_INTERVAL 256
+
+/**
+ * First part of minimax(), up to the ordering of the moves
+ * This function returns true if the node has a score without searching its children, the score is then written in `score`
+ */
+static b32 enter_sliced_node(SearchContext *ctx, SlicedNode *node, i32 *score)
+{
+    Position *pos = &ctx->pos;
+    node->is_entered = true;
+    ctx->nodes++;
+    *score = 0;
+    if (is_search_budget_exhausted(ctx)) {
+        return true;
+    }
+
+    u16 moves;
+    const PositionOutcome outcome = position_outcome(pos, node->last_cell, &moves);
+    if (outcome == POSITION_DRAW) {
+        return true;
+    }
+    if (outcome == POSITION_LOST) {
+        *score = node->is_maximizing ? node->depth - SCORE_WIN : SCORE_WIN - node->depth;
+        return true;
+    }
+
+    i32 endgame_value;
+    if (solve_endgame_node(ctx, node->depth, &endgame_value)) {
+        *score = node->is_maximizing ? endgame_value : -endgame_value;
+        return true;
+    }
+    if (ctx->stop) {
+        return true;
+    }
+
+    if (node->depth >= ctx->max_depth) {
+        ctx->depth_limited = true;
+        *score = evaluator_score(&ctx->eval, &ctx->pos, ctx->root_side);
+        return true;
+    }
+
+    const i32 remaining_depth = ctx->max_depth - node->depth;
+    node->tt_key = get_tt_key(ctx, &node->symmetry);
+    TTEntry entry;
+    i32 tt_move = NO_MOVE;
+    if (tt_probe(ctx->tt, node->tt_key, &entry)) {
+        tt_move = move_from_tt(entry.best_move, node->symmetry);
+        if (entry.depth >= remaining_depth) {
+            mark_if_depth_limited(ctx, &entry);
+            const i32 tt_score = node->is_maximizing ? score_from_tt(entry.score, node->depth) : -score_from_tt(entry.score, node->depth);
+            if (entry.bound == BOUND_EXACT) {
+                *score = tt_score;
+                return true;
+            }
+            else if ((entry.bound == BOUND_LOWER) == node->is_maximizing) {
+                node->alpha = max(node->alpha, tt_score);
+            }
+            else {
+                node->beta = min(node->beta, tt_score);
+            }
+            if (node->beta <= node->alpha) {
+                *score = tt_score;
+                return true;
+            }
+        }
+    }
+
+    node->original_alpha = node->alpha;
+    node->original_beta = node->beta;
+    node->best = node->is_maximizing ? -INT_MAX : INT_MAX;
+    node->best_move = NO_MOVE;
+    order_moves(ctx, moves, tt_move, node->depth, &node->list);
+    node->next_move = 0;
+    return false;
+}
+
+/**
+ * Take the score of the child that has just been searched, as the loops of minimax() do
+ * This function returns true if the node is complete, because of a cutoff or because it has no child left
+ */
+static b32 update_sliced_node(SearchContext *ctx, SlicedNode *node, const i32 score)
+{
+    if (node->is_maximizing) {
+        if (score > node->best) {
+            node->best = score;
+            node->best_move = node->cell;
+        }
+        node->alpha = max(node->alpha, node->best);
+    }
+    else {
+        if (score < node->best) {
+            node->best = score;
+            node->best_move = node->cell;
+        }
+        node->beta = min(node->beta, node->best);
+    }
+
+    if (node->beta <= node->alpha) {
+        record_cutoff(ctx, node->depth, node->cell);
+        return true;
+    }
+    return node->next_move >= node->list.count;
+}
+
+/**
+ * Last part of minimax(): store the result of the node and return its score
+ */
+static i32 leave_sliced_node(SearchContext *ctx, const SlicedNode *node)
+{
+    BoundType bound = BOUND_EXACT;
+    if (node->best <= node->original_alpha) {
+        bound = node->is_maximizing ? BOUND_UPPER : BOUND_LOWER;
+    }
+    else if (node->best >= node->original_beta) {
+        bound = node->is_maximizing ? BOUND_LOWER : BOUND_UPPER;
+    }
+    const i32 remaining_depth = ctx->max_depth - node->depth;
+    tt_store(ctx->tt, node->tt_key, remaining_depth, bound, score_to_tt(node->is_maximizing ? node->best : -node->best, node->depth), move_to_tt(node->best_move, node->symmetry));
+    return node->best;
+}
+
+static void push_sliced_node(SlicedSearch *search, const i32 last_cell, const i32 depth, const b32 is_maximizing, const i32 alpha, const i32 beta)
+{
+    ASSERT(search->stack_size < MAX_PLY, "The sliced search stack is full");
+
+    SlicedNode *node = &search->stack[search->stack_size++];
+    node->last_cell = last_cell;
+    node->depth = depth;
+    node->is_maximizing = is_maximizing;
+    node->alpha = alpha;
+    node->beta = beta;
+    node->is_entered = false;
+}
+
+/**
+ * Run the nodes of the stack until the subtree of the root move returns its score, or until `slice_end`
+ * This function returns false if the slice is over first, the search then resumes at the same node
+ * When the budget is exhausted, ctx->stop is set and the score of the root move is meaningless
+ */
+static b32 run_sliced_stack(SlicedSearch *search, const f64 slice_end, i32 *root_move_value)
+{
+    SearchContext *ctx = &search->ctx;
+    u64 next_check_nodes = ctx->nodes + SLICE_CHECK_INTERVAL;
+
+    while (true) {
+        SlicedNode *node = &search->stack[search->stack_size - 1];
+
+        // An entered node on top of the stack has children left to search
+        if (node->is_entered) {
+            node->cell = pick_next_move(&node->list, node->next_move++);
+            node->previous_last_card = search_make_move(ctx, node->cell);
+            push_sliced_node(search, node->cell, node->depth + 1, !node->is_maximizing, node->alpha, node->beta);
+            continue;
+        }
+
+        if (ctx->nodes >= next_check_nodes) {
+            if (get_precise_time() >= slice_end) {
+                return false;
+            }
+            next_check_nodes = ctx->nodes + SLICE_CHECK_INTERVAL;
+        }
+        i32 score;
+        if (!enter_sliced_node(ctx, node, &score)) {
+            continue;
+        }
+
+        // Give the score to the parents, as long as it completes them
+        while (true) {
+            search->stack_size--;
+            if (search->stack_size == 0) {
+                *root_move_value = score;
+                return true;
+            }
+
+            SlicedNode *parent = &search->stack[search->stack_size - 1];
+            search_unmake_move(ctx, parent->cell, parent->previous_last_card);
+            if (ctx->stop) {
+                // The iteration is discarded, undo the moves of the nodes left on the stack
+                for (i32 i = search->stack_size - 2; i >= 0; i--) {
+                    search_unmake_move(ctx, search->stack[i].cell, search->stack[i].previous_last_card);
                 }
+                search->stack_size = 0;
+                *root_move_value = 0;
+                return true;
+            }
+            if (!update_sliced_node(ctx, parent, score)) {
+                break;
             }
+            score = leave_sliced_node(ctx, parent);
         }
     }
+}
+
+static void start_sliced_root_move(SlicedSearch *search, const i32 cell)
+{
+    search->root_cell = cell;
+    search->root_previous_last_card = search_make_move(&search->ctx, cell);
+    push_sliced_node(search, cell, 0, false, -INT_MAX, INT_MAX);
+}
+
+/**
+ * Start an iteration of the iterative deepening, with the best move of the previous one first as in search_root()
+ */
+static void start_sliced_iteration(SlicedSearch *search, const i32 depth)
+{
+    SearchContext *ctx = &search->ctx;
+    ctx->max_depth = depth;
+    ctx->depth_limited = false;
+
+    search->remaining_root_moves = position_legal_moves(&ctx->pos) & ~CELL_BIT(search->best_cell);
+    search->iteration_best_cell = search->best_cell;
+    search->iteration_best_value = -INT_MAX;
+    start_sliced_root_move(search, search->best_cell);
+}
 
-    return best_move;
+static void finish_sliced_search(SlicedSearch *search)
+{
+    save_search_memory(&search->ctx, search->memory);
+    search->is_done = true;
 }
 
-// Function to get the best move for the AI
-Vec2i get_ai_pressed_tile(Tile board[][BOARD_COLUMNS_NB], const Tile stack_top_card)
+/**
+ * Prepare a sliced search of the best move of `pos`, run_sliced_search() then searches it slice by slice
+ * `settings` must stay valid until the search is freed. Without `memory`, the search starts cold
+ * A root with few cards left is solved here, in one slice at most: each solve of the search is bounded by settings->slice_time,
+ * and the search goes on without the solver when a solve does not fit in it
+ */
+void start_sliced_search(SlicedSearch *search, const Position *pos, const BotSettings *settings, SearchMemory *memory)
 {
-    Vec2i best_move = find_best_move(board, stack_top_card.type);
-    trace_log(LOG_DEBUG, "best move : {%d, %d}", best_move.x, best_move.y);
-    return (Vec2i){best_move.x, best_move.y};
+    search->is_memory_owner = (memory == NULL);
+    search->memory = (memory != NULL) ? memory : create_search_memory(settings);
+    init_search_context(&search->ctx, pos, settings, search->memory);
+    const f64 start_time = get_precise_time();
+    search->ctx.deadline = start_time + settings->time_budget;
+    search->ctx.endgame_time = settings->slice_time;
+    search->time_left = settings->time_budget;
+    search->stack_size = 0;
+    search->completed_depth = 0;
+    search->completed_score = 0;
+    search->is_done = false;
+
+    search->best_cell = get_fallback_move(pos);
+
+    const b32 is_solved = solve_root_endgame(&search->ctx, &search->best_cell, &search->completed_depth, &search->completed_score);
+    search->time_left -= get_precise_time() - start_time;
+    if (is_solved) {
+        finish_sliced_search(search);
+        return;
+    }
+    start_sliced_iteration(search, 1);
+}
+
+/**
+ * Search for `slice_time` seconds at most, and return true once the search is done
+ * The best move is then in search->best_cell
+ */
+b32 run_sliced_search(SlicedSearch *search, const f64 slice_time)
+{
+    if (search->is_done) {
+        return true;
+    }
+
+    SearchContext *ctx = &search->ctx;
+    const f64 start_time = get_precise_time();
+    const f64 slice_end = start_time + slice_time;
+    ctx->deadline = start_time + search->time_left;
+
+    while (true) {
+        i32 move_value;
+        if (!run_sliced_stack(search, slice_end, &move_value)) {
+            search->time_left -= get_precise_time() - start_time;
+            return false;
+        }
+
+        search_unmake_move(ctx, search->root_cell, search->root_previous_last_card);
+        if (ctx->stop) {
+            trace_log(LOG_DEBUG, "depth %d interrupted after %llu nodes", ctx->max_depth, ctx->nodes);
+            finish_sliced_search(search);
+            return true;
+        }
+        trace_log(LOG_DEBUG, "    > tile {row: %d, col: %d}: %d", search->root_cell % BOARD_COLUMNS_NB + 1, search->root_cell / BOARD_COLUMNS_NB + 1, move_value);
+
+        if (move_value > search->iteration_best_value) {
+            search->iteration_best_cell = search->root_cell;
+            search->iteration_best_value = move_value;
+        }
+        if (search->remaining_root_moves != 0) {
+            const i32 cell = __builtin_ctz(search->remaining_root_moves);
+            search->remaining_root_moves &= search->remaining_root_moves - 1;
+            start_sliced_root_move(search, cell);
+            continue;
+        }
+
+        // The iteration is complete
+        search->best_cell = search->iteration_best_cell;
+        search->completed_depth = ctx->max_depth;
+        search->completed_score = search->iteration_best_value;
+        trace_log(LOG_DEBUG, "depth %d: best tile {row: %d, col: %d}, score %d, %llu nodes", ctx->max_depth, search->best_cell % BOARD_COLUMNS_NB + 1, search->best_cell / BOARD_COLUMNS_NB + 1, search->completed_score, ctx->nodes);
+
+        const b32 is_decided = search->completed_score >= SCORE_WIN_BOUND || search->completed_score <= -SCORE_WIN_BOUND;
+        if (!ctx->depth_limited || is_decided || ctx->max_depth >= ctx->settings->max_depth) {
+            finish_sliced_search(search);
+            return true;
+        }
+        start_sliced_iteration(search, ctx->max_depth + 1);
+    }
+}
+
+void free_sliced_search(SlicedSearch *search)
+{
+    if (search->is_memory_owner) {
+        destroy_search_memory(search->memory);
+    }
+    search->memory = NULL;
 }
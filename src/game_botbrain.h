@@ -0,0 +1,449 @@
+#ifndef GAME_BOTBRAIN_H
+#define GAME_BOTBRAIN_H
+
+#include <stdatomic.h>
+
+#include "game.h"
+
+#define NO_MOVE 0xFF
+
+// Default bot settings
+#define BOT_DEFAULT_TIME_BUDGET 1.0f
+#define BOT_DEFAULT_NODE_BUDGET 0
+#define BOT_DEFAULT_MAX_DEPTH 16
+#define BOT_DEFAULT_REPLY_DELAY 0.5f
+#define BOT_DEFAULT_ENDGAME_THRESHOLD 12
+#define BOT_DEFAULT_THREADS 1
+#define BOT_DEFAULT_SLICE_TIME 0.008f // 8000 us of search per frame leave room for the rendering at 60 fps
+#define BOT_DEFAULT_PLAYOUT_BUDGET 0
+#define BOT_DEFAULT_MCTS_EXPLORATION 1.0f
+#ifdef PLATFORM_WEB
+#define BOT_DEFAULT_MCTS_ARENA_NODES (1 << 18) // 4 MB of 16-byte nodes, 8 MB with the spare arena of the tree reuse
+#else
+#define BOT_DEFAULT_MCTS_ARENA_NODES (1 << 20) // 16 MB of 16-byte nodes, 32 MB with the spare arena of the tree reuse
+#endif
+#define PLAYOUT_DRAW -1
+#define EVALUATION_BLOCK_SIZE 256             // positions copied to structure of arrays at a time by evaluate_positions(), 1 KB of tokens
+#define EVALUATION_THREAD_MIN_POSITIONS 65536 // below that, starting a thread costs more than evaluating its positions
+#define PATTERN_STATES_NB 81                  // 3^4 contents of the 4 cells of a pattern
+#define NETWORK_FEATURES_NB (WIN_PATTERNS_NB * PATTERN_STATES_NB)
+#define NETWORK_HIDDEN_NB 16                  // hidden units of the evaluation network, their 16 bits sums fill an AVX2 register
+#define NETWORK_ACTIVATION_MAX 127            // the clipped ReLU keeps the activations in 8 bits
+#define BOT_MAX_THREADS 64
+#define TT_DEFAULT_SIZE_LOG2 18 // 2^18 entries of 16 bytes (4 MB)
+
+#define MAX_PLY BOARD_CELLS_NB
+
+#define SCORE_WIN 10000
+#define SCORE_WIN_BOUND (SCORE_WIN - 64) // Scores beyond this bound come from a finished game
+
+typedef enum {
+    BOUND_NONE,
+    BOUND_EXACT,
+    BOUND_LOWER, // the real score is at least `score` (the search failed high)
+    BOUND_UPPER, // the real score is at most `score` (the search failed low)
+} BoundType;
+
+/**
+ * Transposition table entry, as returned by tt_probe()
+ */
+typedef struct {
+    u64 key;
+    i16 score;
+    u8 depth;     // remaining depth of the search that stored the entry
+    u8 bound;     // BoundType
+    u8 best_move; // cell index or NO_MOVE
+    u8 generation; // generation of the table when the entry was stored
+} TTEntry;
+
+/**
+ * Entry as stored in the table: the score, depth, bound and best move are packed in `data`, and `check` is key ^ data
+ * Threads read and write the two words without lock, an entry mixing two writes does not match its key anymore
+ */
+typedef struct {
+    atomic_ullong check;
+    atomic_ullong data;
+} TTSlot;
+
+typedef struct {
+    TTSlot *slots;
+    u64 mask;     // number of entries - 1, the table size is a power of two
+    b32 is_owner; // false for a view created by tt_share(), the entries belong to another table
+    u8 generation; // incremented by tt_new_search(), so the entries of earlier searches can be told apart
+
+    // Statistics, a collision is a probe that finds the slot used by another position
+    u64 hits;
+    u64 reused; // hits on entries stored by earlier searches
+    u64 misses;
+    u64 collisions;
+    u64 stores;
+} TranspositionTable;
+
+/**
+ * Moves of one node, picked from the highest score to the lowest
+ */
+typedef struct {
+    u8 cells[BOARD_CELLS_NB];
+    i32 scores[BOARD_CELLS_NB];
+    i32 count;
+} MoveList;
+
+typedef struct MctsTree MctsTree;
+
+/**
+ * Search state that the bot keeps between its moves of one game, see create_search_memory()
+ * The transposition table stays valid from one move to the next, the killers and history are aged at each new move
+ */
+struct SearchMemory {
+    TranspositionTable tt;
+    u8 killers[MAX_PLY][2];
+    u32 history[2][BOARD_CELLS_NB];
+    i32 root_ply; // tokens on the board at the root of the last search, -1 before the first search
+    MctsTree *mcts_tree; // NULL unless the engine is MCTS
+};
+
+typedef struct WorkStealingScheduler WorkStealingScheduler;
+
+/**
+ * State shared by the threads of a parallel search
+ */
+typedef struct {
+    atomic_bool stop;    // set by the first thread that finds the budget exhausted
+    atomic_ullong nodes; // nodes of all the threads, each thread adds its nodes in batches
+    WorkStealingScheduler *scheduler; // task deques of the threads, NULL unless the parallelism is work stealing
+} SharedSearchState;
+
+typedef enum {
+    EVALUATION_KERNEL_SCALAR, // one table lookup per pattern
+    EVALUATION_KERNEL_VECTOR, // all the patterns at once in the vector registers of the target: SSE2, NEON or wasm simd128
+    EVALUATION_KERNEL_AVX2,   // same in AVX2 registers, on the x86 processors that have them
+    EVALUATION_KERNELS_NB,
+} EvaluationKernel;
+
+/**
+ * Quantized evaluation network, loaded from a file written by tools/train_network.c
+ * Its features are the states of the patterns, one-hot: feature pattern * PATTERN_STATES_NB + state is 1 if the pattern is in that state
+ * The hidden layer is a sum of int8 weight rows, one per pattern, so a move only swaps the rows of the patterns going through its cell
+ * The output is (output_weights . clamp(hidden, 0, NETWORK_ACTIVATION_MAX) + output_bias) >> output_shift, for player 1
+ * The search keeps at least 2/3 of its nodes per second with the network instead of the pattern table (bench_bot network)
+ */
+struct EvaluationNetwork {
+    i8 feature_weights[NETWORK_FEATURES_NB][NETWORK_HIDDEN_NB];
+    i16 hidden_biases[NETWORK_HIDDEN_NB];
+    i8 output_weights[NETWORK_HIDDEN_NB];
+    i32 output_bias;
+    i32 output_shift;
+};
+
+/**
+ * Evaluation of a position kept up to date move by move, each move only changes the patterns going through its cell
+ * Without a network, nothing is kept: the leaves are scored from scratch by evaluate_position()
+ */
+typedef struct {
+    u8 states[WIN_PATTERNS_NB];       // content of each pattern in base 3, see game_evaluation.c, only kept up to date with a network
+    const EvaluationNetwork *network; // NULL to score the position with the pattern table
+    i16 hidden[NETWORK_HIDDEN_NB];    // hidden layer of `network` before its activation
+} Evaluator;
+
+typedef struct SearchThreads SearchThreads;
+typedef struct SplitPoint SplitPoint;
+
+/**
+ * State of one search, the root position is modified in place by make/unmake
+ * In a parallel search, every thread has its own context
+ */
+typedef struct {
+    Position pos;
+    Evaluator eval; // evaluation of `pos`, search_make_move() and search_unmake_move() keep both in step
+    i32 root_side;  // side of the bot, scores are given from its point of view
+    TranspositionTable *tt;
+    const BotSettings *settings;
+    i32 endgame_threshold; // settings->endgame_threshold, 0 once the solver gave up
+    f64 endgame_time;      // seconds a single solve may take, 0 to only stop at the deadline (the sliced search gives it one slice)
+
+    // Move ordering heuristics: moves that caused a cutoff at the same ply, and cutoffs counted per side and cell
+    u8 killers[MAX_PLY][2];
+    u32 history[2][BOARD_CELLS_NB];
+
+    i32 max_depth;      // depth of the current iteration
+    b32 depth_limited;  // true if a leaf of the current iteration was cut by the depth limit
+    u64 nodes;
+    f64 deadline;
+    atomic_bool *cancel; // set by another thread to stop the search early, can be NULL
+    b32 stop;           // set when the budget is exhausted, the current iteration is then discarded
+
+    SharedSearchState *shared; // NULL when the search runs on a single thread
+    SearchThreads *threads;    // helper threads, only set in the context of the calling thread
+    i32 thread_index;          // 0 for the calling thread, 1 + i for helper i
+    SplitPoint *split;         // innermost split point whose subtree the thread searches (work stealing only)
+} SearchContext;
+
+/**
+ * Helper threads of a parallel search, each one with its own context and transposition table
+ */
+struct SearchThreads {
+    SearchContext *helpers;
+    TranspositionTable *tts;
+    i32 helpers_nb;
+    SharedSearchState shared;
+};
+
+/**
+ * Node of a sliced search, it holds what minimax() keeps in its local variables
+ */
+typedef struct {
+    i32 last_cell;
+    i32 depth;
+    b32 is_maximizing;
+    i32 alpha;
+    i32 beta;
+    b32 is_entered; // false until the node has been checked for the end of the game, the depth limit and the transposition table
+
+    i32 original_alpha;
+    i32 original_beta;
+    i32 best;
+    i32 best_move;
+    u64 tt_key;
+    i32 symmetry;
+    MoveList list;
+    i32 next_move;               // index in `list` of the next child to search
+    i32 cell;                    // child being searched
+    TileType previous_last_card; // to unmake the move of the child being searched
+} SlicedNode;
+
+/**
+ * Minimax search that runs a few milliseconds at a time, for builds without threads
+ * The recursion of minimax() is replaced by an explicit stack of nodes, so the search can stop between two nodes and resume at the next frame
+ * It finds the same moves as search_best_move() with one thread and the minimax algorithm
+ */
+typedef struct {
+    SearchContext ctx;
+    SearchMemory *memory;
+    b32 is_memory_owner; // the memory has been created for this search only
+
+    SlicedNode stack[MAX_PLY];
+    i32 stack_size; // 0 between two root moves
+
+    // Iterative deepening: root move being searched, and the root moves left in the current iteration
+    i32 root_cell;
+    TileType root_previous_last_card;
+    u16 remaining_root_moves;
+    i32 iteration_best_cell;
+    i32 iteration_best_value;
+
+    i32 best_cell; // best move of the last complete iteration
+    i32 completed_depth;
+    i32 completed_score;
+    f64 time_left; // the time budget only counts the time spent in the slices
+    b32 is_done;
+} SlicedSearch;
+
+typedef enum {
+    MCTS_ONGOING,
+    MCTS_WIN,  // the player who moved into the node has won
+    MCTS_DRAW,
+} MctsOutcome;
+
+typedef enum {
+    MCTS_UNEXPANDED,
+    MCTS_EXPANDING, // a thread is creating the children, the others treat the node as a leaf
+    MCTS_EXPANDED,
+} MctsNodeState;
+
+/**
+ * Node of the MCTS tree, for the position after the move `cell`
+ * The children of a node are created together and are contiguous in the arena
+ * A thread counts its visit when it selects the node, and only adds the score once its playout is done:
+ * until then the visit counts as a loss (virtual loss), which steers the other threads to other nodes
+ */
+typedef struct {
+    u32 first_child;
+    u8 children_nb;
+    u8 cell;
+    u8 outcome;         // MctsOutcome
+    atomic_uchar state; // MctsNodeState, the children can be read once it is MCTS_EXPANDED
+    atomic_uint visits;
+    atomic_uint score; // half points of the player who moved into the node: 2 per win, 1 per draw
+} MctsNode;
+
+/**
+ * Nodes of a tree, allocated one after the other and freed all at once
+ */
+typedef struct {
+    MctsNode *nodes;
+    u32 capacity;
+    atomic_uint used;
+} MctsArena;
+
+/**
+ * MCTS tree kept between the searches of a game
+ * Before each search, the subtree of the new root is copied to the spare arena, which then becomes the arena:
+ * the rest of the old tree is reclaimed at once
+ */
+struct MctsTree {
+    MctsArena arena; // root node is nodes[0]
+    MctsArena spare; // allocated at the first reuse
+    Position root;
+    b32 has_root;
+};
+
+/**
+ * Monte carlo tree search with the UCT selection, it can run in slices like SlicedSearch
+ * search_mcts() runs it on several threads, which share the tree
+ */
+typedef struct {
+    Position root;
+    const BotSettings *settings;
+    atomic_bool *cancel; // can be NULL
+    MctsTree *tree;
+    b32 is_tree_owner;
+    u64 random_state; // of the calling thread, each helper thread has its own
+
+    atomic_ullong started_playouts; // playouts started by all the threads, against the playout budget
+    atomic_bool stop;
+    u64 playouts;
+    u64 reused_visits; // visits of the root kept from the earlier searches
+    i32 tree_depth;    // deepest node reached by the selection
+    f64 time_left;     // the time budget only counts the time spent in run_mcts_search()
+    b32 is_done;
+} MctsSearch;
+
+/**
+ * Results of random playouts, counted from the point of view of the players
+ */
+typedef struct {
+    u32 wins[2];
+    u32 draws;
+} PlayoutResults;
+
+/**
+ * Result of a search, filled by search_best_move()
+ */
+typedef struct {
+    i32 best_cell;
+    i32 score;
+    i32 depth; // depth of the last complete iteration, depth of the tree with MCTS
+    u64 nodes; // nodes of all the threads, playouts with MCTS
+    i32 threads;
+    u64 thread_nodes[BOT_MAX_THREADS];
+    f64 time;
+    u64 tt_hits;
+    u64 tt_reused; // hits on entries stored by earlier searches of the same memory
+    u64 tt_misses;
+    u64 tt_collisions;
+    u64 mcts_reused; // visits of the MCTS root kept from the earlier searches
+} SearchStats;
+
+typedef enum {
+    OUTCOME_LOSS = -1,
+    OUTCOME_DRAW = 0,
+    OUTCOME_WIN = 1,
+} GameOutcome;
+
+/**
+ * Exact result of a position, filled by solve_endgame()
+ */
+typedef struct {
+    GameOutcome outcome; // for the side to move
+    i32 distance;        // plies until the end of the game with perfect play from both sides
+    i32 best_cell;
+    u64 nodes;
+    b32 is_complete;     // false if the solver was interrupted, the other fields are then meaningless
+} EndgameResult;
+
+/**
+ * Exact value of a first move, for the first player
+ */
+typedef struct {
+    GameOutcome outcome;
+    i32 distance; // plies until the end of the game, -1 if the move is not legal
+} DealMoveValue;
+
+/**
+ * Exact value of a whole game, filled by solve_deal()
+ */
+typedef struct {
+    GameOutcome outcome; // for the first player
+    i32 distance;
+    i32 best_cell;
+    DealMoveValue moves[BOARD_CELLS_NB];
+    u64 nodes;
+    f64 time;
+} DealSolution;
+
+// search
+i32 search_best_move(const Position *pos, const BotSettings *settings, atomic_bool *cancel, SearchStats *stats);
+i32 search_best_move_with_memory(const Position *pos, const BotSettings *settings, SearchMemory *memory, atomic_bool *cancel, SearchStats *stats);
+
+// sliced search
+void start_sliced_search(SlicedSearch *search, const Position *pos, const BotSettings *settings, SearchMemory *memory);
+b32 run_sliced_search(SlicedSearch *search, const f64 slice_time);
+void free_sliced_search(SlicedSearch *search);
+
+TileType search_make_move(SearchContext *ctx, const i32 cell);
+void search_unmake_move(SearchContext *ctx, const i32 cell, const TileType previous_last_card);
+i32 search_root_move(SearchContext *ctx, const i32 cell, const i32 alpha);
+i32 minimax(SearchContext *ctx, i32 last_cell, i32 depth, b32 is_maximizing, i32 alpha, i32 beta);
+i32 negascout(SearchContext *ctx, i32 last_cell, i32 depth, i32 alpha, i32 beta);
+i32 search_iterative(SearchContext *ctx, const i32 start_depth, i32 *completed_depth, i32 *completed_score);
+
+// parallel search
+void init_search_threads(SearchThreads *threads, SearchContext *ctx, const i32 helpers_nb);
+void free_search_threads(SearchThreads *threads);
+void stop_search_threads(SearchThreads *threads);
+b32 search_root_parallel(SearchContext *ctx, i32 *best_cell, i32 *best_value);
+i32 search_lazy_smp(SearchContext *ctx, i32 *completed_depth, i32 *completed_score);
+
+// work stealing
+void init_work_stealing(SearchThreads *threads);
+void stop_work_stealing(SearchThreads *threads);
+b32 is_split_cancelled(const SplitPoint *split);
+i32 search_split(SearchContext *ctx, const u8 *cells, const i32 cells_nb, const i32 depth, const b32 is_maximizing, i32 *alpha, i32 *beta, i32 *best, i32 *best_move);
+
+// evaluation
+i32 evaluate_board(const Position *pos, const i32 side);
+i32 evaluate_position(const Position *pos);
+b32 is_evaluation_kernel_supported(const EvaluationKernel kernel);
+b32 set_evaluation_kernel(const EvaluationKernel kernel);
+EvaluationKernel get_evaluation_kernel(void);
+const char *get_evaluation_kernel_name(const EvaluationKernel kernel);
+void evaluate_tokens(const u16 *tokens0, const u16 *tokens1, i32 *scores, const u32 positions_nb);
+void evaluate_positions(const Position *positions, i32 *scores, const u32 positions_nb, const i32 threads_nb);
+void evaluator_init(Evaluator *eval, const Position *pos, const EvaluationNetwork *network);
+void evaluator_add_token(Evaluator *eval, const i32 side, const i32 cell);
+void evaluator_remove_token(Evaluator *eval, const i32 side, const i32 cell);
+i32 evaluator_score(const Evaluator *eval, const Position *pos, const i32 side);
+
+// evaluation network
+b32 save_evaluation_network(const EvaluationNetwork *network, const char *filepath);
+
+// random playouts
+u32 playout_random(u64 *state);
+i32 random_playout(Position *pos, u64 *random_state);
+u32 get_playout_batch_size(void);
+void run_playout_batch(const Position *pos, u64 *random_state, PlayoutResults *results);
+
+// monte carlo tree search
+MctsTree *create_mcts_tree(const BotSettings *settings);
+void destroy_mcts_tree(MctsTree *tree);
+void init_mcts_search(MctsSearch *search, const Position *pos, const BotSettings *settings, MctsTree *tree, atomic_bool *cancel);
+b32 run_mcts_search(MctsSearch *search, const f64 slice_time);
+i32 get_mcts_best_move(const MctsSearch *search);
+void free_mcts_search(MctsSearch *search);
+i32 search_mcts(const Position *pos, const BotSettings *settings, MctsTree *tree, atomic_bool *cancel, SearchStats *stats);
+
+// endgame
+EndgameResult solve_endgame(const Position *pos, const f64 deadline, const u64 node_budget, atomic_bool *cancel);
+
+// whole game solver
+DealSolution solve_deal(const Tile board[][BOARD_COLUMNS_NB]);
+
+// transposition table
+void tt_init(TranspositionTable *tt, const i32 size_log2);
+void tt_share(TranspositionTable *view, const TranspositionTable *owner);
+void tt_free(TranspositionTable *tt);
+void tt_new_search(TranspositionTable *tt);
+b32 tt_probe(TranspositionTable *tt, const u64 key, TTEntry *entry);
+void tt_store(TranspositionTable *tt, const u64 key, const i32 depth, const BoundType bound, const i32 score, const i32 best_move);
+
+#endif
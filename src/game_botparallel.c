@@ -0,0 +1,233 @@
+#ifndef PLATFORM_WEB
+
+#include <limits.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "game_botbrain.h"
+
+/**
+ * Root moves of one iteration, shared by the threads
+ * Each thread takes the next move that nobody searches yet, and searches it with the best score found so far as alpha
+ */
+typedef struct {
+    u8 moves[BOARD_CELLS_NB];
+    i32 moves_nb;
+    atomic_int next_move;
+
+    atomic_int alpha; // best score so far, read by the threads before each move
+    pthread_mutex_t lock;
+    i32 best_cell;
+    i32 best_value;
+} RootSplit;
+
+typedef struct {
+    SearchContext *ctx;
+    RootSplit *split;
+} RootSplitWorker;
+
+typedef struct {
+    SearchContext *ctx;
+    i32 start_depth;
+} LazySmpWorker;
+
+/**
+ * Give helper threads to the search of `ctx`
+ * Each helper has its own copy of the root position and its own move ordering heuristics
+ * With the root split, each helper also has its own transposition table. Otherwise they all use the table of `ctx`
+ * The work stealing helpers are started here and wait for tasks until stop_search_threads()
+ */
+void init_search_threads(SearchThreads *threads, SearchContext *ctx, const i32 helpers_nb)
+{
+    ASSERT(helpers_nb > 0 && helpers_nb < BOT_MAX_THREADS, "Wrong number of helper threads");
+
+    threads->helpers_nb = helpers_nb;
+    atomic_init(&threads->shared.stop, false);
+    atomic_init(&threads->shared.nodes, 0);
+    threads->helpers = calloc(helpers_nb, sizeof(SearchContext));
+    threads->tts = calloc(helpers_nb, sizeof(TranspositionTable));
+    if (threads->helpers == NULL || threads->tts == NULL) {
+        application_panic(__FILE__, __LINE__, "Memory allocation failed");
+    }
+
+    ctx->shared = &threads->shared;
+    for (i32 i = 0; i < helpers_nb; i++) {
+        SearchContext *helper = &threads->helpers[i];
+        *helper = *ctx;
+        if (ctx->settings->parallelism == BOT_PARALLEL_ROOT_SPLIT) {
+            tt_init(&threads->tts[i], ctx->settings->tt_size_log2);
+        }
+        else {
+            tt_share(&threads->tts[i], ctx->tt);
+        }
+        helper->tt = &threads->tts[i];
+        helper->nodes = 0;
+        helper->threads = NULL;
+        helper->thread_index = 1 + i;
+    }
+    ctx->threads = threads;
+
+    threads->shared.scheduler = NULL;
+    if (ctx->settings->parallelism == BOT_PARALLEL_WORK_STEALING) {
+        init_work_stealing(threads);
+    }
+}
+
+/**
+ * Stop the helpers that still run once the search is over, their node counts can be read afterwards
+ */
+void stop_search_threads(SearchThreads *threads)
+{
+    if (threads->shared.scheduler != NULL) {
+        stop_work_stealing(threads);
+    }
+}
+
+void free_search_threads(SearchThreads *threads)
+{
+    for (i32 i = 0; i < threads->helpers_nb; i++) {
+        tt_free(&threads->tts[i]);
+    }
+    free(threads->helpers);
+    free(threads->tts);
+    threads->helpers = NULL;
+    threads->tts = NULL;
+    threads->helpers_nb = 0;
+}
+
+static void search_split_moves(SearchContext *ctx, RootSplit *split)
+{
+    while (true) {
+        const i32 index = atomic_fetch_add(&split->next_move, 1);
+        if (index >= split->moves_nb) {
+            return;
+        }
+
+        const i32 cell = split->moves[index];
+        const i32 move_value = search_root_move(ctx, cell, atomic_load(&split->alpha));
+        if (ctx->stop) {
+            return;
+        }
+
+        pthread_mutex_lock(&split->lock);
+        if (move_value > split->best_value) {
+            split->best_value = move_value;
+            split->best_cell = cell;
+            atomic_store(&split->alpha, move_value);
+        }
+        pthread_mutex_unlock(&split->lock);
+    }
+}
+
+static void *run_split_worker(void *arg)
+{
+    RootSplitWorker *worker = arg;
+    search_split_moves(worker->ctx, worker->split);
+    return NULL;
+}
+
+/**
+ * Parallel version of search_root(): the previous best move is searched first on the calling thread to get an alpha bound,
+ * then the other root moves are split between the calling thread and the helpers
+ * Root moves that cannot beat the best score only get an upper bound, like with PVS
+ * This function returns false if the iteration has been interrupted by the budget
+ */
+b32 search_root_parallel(SearchContext *ctx, i32 *best_cell, i32 *best_value)
+{
+    SearchThreads *threads = ctx->threads;
+    const i32 first_value = search_root_move(ctx, *best_cell, -INT_MAX);
+    if (ctx->stop) {
+        return false;
+    }
+
+    RootSplit split;
+    split.moves_nb = 0;
+    for (u16 remaining = position_legal_moves(&ctx->pos) & ~CELL_BIT(*best_cell); remaining != 0; remaining &= remaining - 1) {
+        split.moves[split.moves_nb++] = __builtin_ctz(remaining);
+    }
+    atomic_init(&split.next_move, 0);
+    atomic_init(&split.alpha, first_value);
+    pthread_mutex_init(&split.lock, NULL);
+    split.best_cell = *best_cell;
+    split.best_value = first_value;
+
+    // Start as many helpers as there are moves left, the calling thread searches too
+    const i32 helpers_nb = (split.moves_nb - 1 < threads->helpers_nb) ? split.moves_nb - 1 : threads->helpers_nb;
+    pthread_t thread_ids[BOT_MAX_THREADS];
+    RootSplitWorker workers[BOT_MAX_THREADS];
+    i32 started_nb = 0;
+    for (i32 i = 0; i < helpers_nb; i++) {
+        SearchContext *helper = &threads->helpers[i];
+        helper->max_depth = ctx->max_depth;
+        helper->depth_limited = false;
+        workers[i] = (RootSplitWorker){helper, &split};
+        if (pthread_create(&thread_ids[i], NULL, run_split_worker, &workers[i]) != 0) {
+            // The other threads and the calling thread search the remaining moves
+            trace_log(LOG_WARNING, "failed to start a search thread");
+            break;
+        }
+        started_nb++;
+    }
+
+    search_split_moves(ctx, &split);
+
+    for (i32 i = 0; i < started_nb; i++) {
+        pthread_join(thread_ids[i], NULL);
+        SearchContext *helper = &threads->helpers[i];
+        ctx->depth_limited |= helper->depth_limited;
+        if (helper->stop) {
+            ctx->stop = true;
+        }
+    }
+    pthread_mutex_destroy(&split.lock);
+
+    if (ctx->stop) {
+        return false;
+    }
+    *best_cell = split.best_cell;
+    *best_value = split.best_value;
+    return true;
+}
+
+static void *run_lazy_smp_worker(void *arg)
+{
+    LazySmpWorker *worker = arg;
+    i32 depth = 0;
+    i32 score = 0;
+    search_iterative(worker->ctx, worker->start_depth, &depth, &score);
+    return NULL;
+}
+
+/**
+ * Lazy SMP: the helpers search the same root as the calling thread, by iterative deepening from staggered depths
+ * They only communicate through the shared transposition table, where they leave results the calling thread reuses
+ * The move played is the one of the calling thread, the helpers are stopped when it is done
+ */
+i32 search_lazy_smp(SearchContext *ctx, i32 *completed_depth, i32 *completed_score)
+{
+    SearchThreads *threads = ctx->threads;
+    pthread_t thread_ids[BOT_MAX_THREADS];
+    LazySmpWorker workers[BOT_MAX_THREADS];
+    i32 started_nb = 0;
+
+    for (i32 i = 0; i < threads->helpers_nb; i++) {
+        // Two helpers start at depth 2, two at depth 3... so the threads do not all search the same iteration
+        const i32 start_depth = 2 + i / 2;
+        workers[i] = (LazySmpWorker){&threads->helpers[i], (start_depth < ctx->settings->max_depth) ? start_depth : ctx->settings->max_depth};
+        if (pthread_create(&thread_ids[i], NULL, run_lazy_smp_worker, &workers[i]) != 0) {
+            trace_log(LOG_WARNING, "failed to start a search thread");
+            break;
+        }
+        started_nb++;
+    }
+
+    const i32 best_cell = search_iterative(ctx, 1, completed_depth, completed_score);
+
+    atomic_store(&threads->shared.stop, true);
+    for (i32 i = 0; i < started_nb; i++) {
+        pthread_join(thread_ids[i], NULL);
+    }
+    return best_cell;
+}
+
+#endif
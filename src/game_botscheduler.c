@@ -0,0 +1,341 @@
+#ifndef PLATFORM_WEB
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "game_botbrain.h"
+
+// Each thread can have this many tasks waiting in its deque, a split point pushes at most BOARD_CELLS_NB - 2 tasks per ply
+#define TASK_DEQUE_SIZE 256
+
+/**
+ * Node whose children after the first one are searched by several threads
+ * It lives on the stack of the thread that split the node (its owner), which waits until all the tasks are done
+ */
+struct SplitPoint {
+    Position pos; // position of the node, copied by the threads that steal a task
+    Evaluator eval;
+    i32 depth;
+    i32 max_depth;
+    b32 is_maximizing;
+    SplitPoint *parent; // split point above this one, a cutoff there cancels this one too
+
+    pthread_mutex_t lock;
+    i32 alpha;
+    i32 beta;
+    i32 best;
+    i32 best_move;
+    i32 cutoff_move;
+    b32 depth_limited;
+
+    atomic_int pending;    // tasks not finished yet
+    atomic_bool cancelled; // set on a cutoff, the tasks still running give up
+};
+
+typedef struct {
+    SplitPoint *split;
+    u8 cell;
+} SearchTask;
+
+/**
+ * Tasks of one thread: the owner pushes and pops at the bottom, the other threads steal the oldest tasks at the top
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    SearchTask tasks[TASK_DEQUE_SIZE];
+    u32 top;
+    u32 bottom;
+} TaskDeque;
+
+struct WorkStealingScheduler {
+    TaskDeque deques[BOT_MAX_THREADS];
+    SearchContext *contexts[BOT_MAX_THREADS];
+    pthread_t thread_ids[BOT_MAX_THREADS];
+    i32 threads_nb;
+    i32 started_nb;
+    atomic_bool done;
+};
+
+static void push_task(TaskDeque *deque, const SearchTask task)
+{
+    pthread_mutex_lock(&deque->lock);
+    ASSERT(deque->bottom - deque->top < TASK_DEQUE_SIZE, "Task deque overflow");
+    deque->tasks[deque->bottom % TASK_DEQUE_SIZE] = task;
+    deque->bottom++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/**
+ * Pop the newest task of the deque if it belongs to `split`
+ */
+static b32 pop_task(TaskDeque *deque, const SplitPoint *split, SearchTask *task)
+{
+    b32 found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom != deque->top && deque->tasks[(deque->bottom - 1) % TASK_DEQUE_SIZE].split == split) {
+        deque->bottom--;
+        *task = deque->tasks[deque->bottom % TASK_DEQUE_SIZE];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static b32 is_split_below(const SplitPoint *split, const SplitPoint *ancestor)
+{
+    for (; split != NULL; split = split->parent) {
+        if (split == ancestor) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Steal the oldest task of the deque
+ * If `ancestor` is not NULL, the task is only stolen if its split point is `ancestor` or a split point below it
+ */
+static b32 steal_task(TaskDeque *deque, const SplitPoint *ancestor, SearchTask *task)
+{
+    b32 found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom != deque->top && (ancestor == NULL || is_split_below(deque->tasks[deque->top % TASK_DEQUE_SIZE].split, ancestor))) {
+        *task = deque->tasks[deque->top % TASK_DEQUE_SIZE];
+        deque->top++;
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+b32 is_split_cancelled(const SplitPoint *split)
+{
+    for (; split != NULL; split = split->parent) {
+        if (atomic_load_explicit(&split->cancelled, memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Search the child `cell` of a split point with the window (alpha, beta), as the search that split the node would have
+ * With PVS, the child is searched with a null window first, and again with the window only if it is better than alpha
+ */
+static i32 search_split_child(SearchContext *ctx, const SplitPoint *split, const i32 cell, const i32 alpha, const i32 beta)
+{
+    if (ctx->settings->algorithm != BOT_ALGORITHM_PVS) {
+        return minimax(ctx, cell, split->depth + 1, !split->is_maximizing, alpha, beta);
+    }
+    i32 score = -negascout(ctx, cell, split->depth + 1, -alpha - 1, -alpha);
+    if (score > alpha && score < beta && !ctx->stop) {
+        score = -negascout(ctx, cell, split->depth + 1, -beta, -alpha);
+    }
+    return score;
+}
+
+/**
+ * Search one child of a split point and merge its score
+ * The owner searches on its own position, which is the one of the split point, other threads copy the position first
+ */
+static void run_task(SearchContext *ctx, const SearchTask task)
+{
+    SplitPoint *split = task.split;
+    SplitPoint *saved_split = ctx->split;
+    const b32 saved_depth_limited = ctx->depth_limited;
+
+    pthread_mutex_lock(&split->lock);
+    const i32 alpha = split->alpha;
+    const i32 beta = split->beta;
+    pthread_mutex_unlock(&split->lock);
+
+    if (ctx->split != split) {
+        ctx->pos = split->pos;
+        ctx->eval = split->eval;
+        ctx->max_depth = split->max_depth;
+    }
+    ctx->split = split;
+    ctx->depth_limited = false;
+
+    i32 score = 0;
+    b32 is_complete = false;
+    if (!is_split_cancelled(split)) {
+        const TileType previous_last_card = search_make_move(ctx, task.cell);
+        score = search_split_child(ctx, split, task.cell, alpha, beta);
+        search_unmake_move(ctx, task.cell, previous_last_card);
+        is_complete = !ctx->stop;
+    }
+    const b32 depth_limited = ctx->depth_limited;
+
+    // The thread stopped because of this subtree, the search above goes on unless it has been cancelled too
+    ctx->split = saved_split;
+    ctx->depth_limited = saved_depth_limited;
+    ctx->stop = atomic_load(&ctx->shared->stop) || (saved_split != NULL && is_split_cancelled(saved_split));
+
+    pthread_mutex_lock(&split->lock);
+    if (is_complete && !atomic_load(&split->cancelled)) {
+        if (split->is_maximizing ? score > split->best : score < split->best) {
+            split->best = score;
+            split->best_move = task.cell;
+        }
+        if (split->is_maximizing) {
+            split->alpha = (split->alpha > split->best) ? split->alpha : split->best;
+        }
+        else {
+            split->beta = (split->beta < split->best) ? split->beta : split->best;
+        }
+        if (split->beta <= split->alpha) {
+            split->cutoff_move = task.cell;
+            atomic_store(&split->cancelled, true);
+        }
+    }
+    split->depth_limited |= depth_limited;
+    pthread_mutex_unlock(&split->lock);
+
+    atomic_fetch_sub(&split->pending, 1);
+}
+
+/**
+ * Steal a task of a split point below `ancestor` from the deques of the other threads
+ */
+static b32 steal_task_below(WorkStealingScheduler *scheduler, const i32 thread_index, const SplitPoint *ancestor, SearchTask *task)
+{
+    for (i32 i = 1; i < scheduler->threads_nb; i++) {
+        if (steal_task(&scheduler->deques[(thread_index + i) % scheduler->threads_nb], ancestor, task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Young brothers wait split: the first child of the node of `ctx` has been searched, the other ones (`cells`) become tasks
+ * The owner searches its own tasks, idle threads steal the other ones. A cutoff cancels the tasks still running
+ * PVS splits its nodes in negamax form, as a maximizing node whose window is given from the point of view of the side to move
+ * The window and the best score of the node are updated, this function returns the move that caused a cutoff or NO_MOVE
+ */
+i32 search_split(SearchContext *ctx, const u8 *cells, const i32 cells_nb, const i32 depth, const b32 is_maximizing, i32 *alpha, i32 *beta, i32 *best, i32 *best_move)
+{
+    WorkStealingScheduler *scheduler = ctx->shared->scheduler;
+    TaskDeque *deque = &scheduler->deques[ctx->thread_index];
+
+    SplitPoint split;
+    split.pos = ctx->pos;
+    split.eval = ctx->eval;
+    split.depth = depth;
+    split.max_depth = ctx->max_depth;
+    split.is_maximizing = is_maximizing;
+    split.parent = ctx->split;
+    pthread_mutex_init(&split.lock, NULL);
+    split.alpha = *alpha;
+    split.beta = *beta;
+    split.best = *best;
+    split.best_move = *best_move;
+    split.cutoff_move = NO_MOVE;
+    split.depth_limited = false;
+    atomic_init(&split.pending, cells_nb);
+    atomic_init(&split.cancelled, false);
+
+    // Pushed in reverse order: the owner pops the most promising moves first, thieves steal the least promising ones
+    for (i32 i = cells_nb - 1; i >= 0; i--) {
+        push_task(deque, (SearchTask){&split, cells[i]});
+    }
+
+    // Once its own tasks are taken, the owner helps the threads that search them: it steals the tasks of the split points below
+    // its own one, which are over before its split point is. The tasks of other split points could keep it busy long after
+    while (atomic_load(&split.pending) > 0) {
+        SearchTask task;
+        if (pop_task(deque, &split, &task)) {
+            if (atomic_load(&split.cancelled)) {
+                atomic_fetch_sub(&split.pending, 1);
+            }
+            else {
+                run_task(ctx, task);
+            }
+        }
+        else if (steal_task_below(scheduler, ctx->thread_index, &split, &task)) {
+            run_task(ctx, task);
+            ctx->pos = split.pos;
+            ctx->eval = split.eval;
+            ctx->max_depth = split.max_depth;
+        }
+        else {
+            sched_yield();
+        }
+    }
+    pthread_mutex_destroy(&split.lock);
+
+    *alpha = split.alpha;
+    *beta = split.beta;
+    *best = split.best;
+    *best_move = split.best_move;
+    ctx->depth_limited |= split.depth_limited;
+    ctx->stop = atomic_load(&ctx->shared->stop) || (split.parent != NULL && is_split_cancelled(split.parent));
+    return split.cutoff_move;
+}
+
+/**
+ * Loop of a helper thread: steal tasks from the other threads until the search is over
+ */
+static void *run_work_stealing_worker(void *arg)
+{
+    SearchContext *ctx = arg;
+    WorkStealingScheduler *scheduler = ctx->shared->scheduler;
+
+    while (!atomic_load(&scheduler->done)) {
+        b32 found = false;
+        for (i32 i = 1; i < scheduler->threads_nb && !found; i++) {
+            SearchTask task;
+            if (steal_task(&scheduler->deques[(ctx->thread_index + i) % scheduler->threads_nb], NULL, &task)) {
+                run_task(ctx, task);
+                found = true;
+            }
+        }
+        if (!found) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Create the task deques and start the helpers, the calling thread is thread 0
+ */
+void init_work_stealing(SearchThreads *threads)
+{
+    WorkStealingScheduler *scheduler = calloc(1, sizeof(WorkStealingScheduler));
+    if (scheduler == NULL) {
+        application_panic(__FILE__, __LINE__, "Memory allocation failed");
+    }
+    scheduler->threads_nb = 1 + threads->helpers_nb;
+    atomic_init(&scheduler->done, false);
+    for (i32 i = 0; i < scheduler->threads_nb; i++) {
+        pthread_mutex_init(&scheduler->deques[i].lock, NULL);
+    }
+    threads->shared.scheduler = scheduler;
+
+    for (i32 i = 0; i < threads->helpers_nb; i++) {
+        if (pthread_create(&scheduler->thread_ids[i], NULL, run_work_stealing_worker, &threads->helpers[i]) != 0) {
+            // The tasks are still searched by the owners and by the helpers already started
+            trace_log(LOG_WARNING, "failed to start a search thread");
+            break;
+        }
+        scheduler->started_nb++;
+    }
+}
+
+void stop_work_stealing(SearchThreads *threads)
+{
+    WorkStealingScheduler *scheduler = threads->shared.scheduler;
+    atomic_store(&scheduler->done, true);
+    for (i32 i = 0; i < scheduler->started_nb; i++) {
+        pthread_join(scheduler->thread_ids[i], NULL);
+    }
+    for (i32 i = 0; i < scheduler->threads_nb; i++) {
+        pthread_mutex_destroy(&scheduler->deques[i].lock);
+    }
+    free(scheduler);
+    threads->shared.scheduler = NULL;
+}
+
+#endif
@@ -0,0 +1,138 @@
+#include <limits.h>
+
+#include "game_botbrain.h"
+
+// Scores of the solver: a game won in n plies scores ENDGAME_WIN - n, a game lost in n plies scores n - ENDGAME_WIN
+#define ENDGAME_WIN 1000
+
+// The deadline and the cancel flag are checked once every ENDGAME_CHECK_INTERVAL nodes
+#define ENDGAME_CHECK_INTERVAL 4096
+
+typedef struct {
+    Position pos;
+    u64 nodes;
+    f64 deadline;
+    u64 node_budget;
+    atomic_bool *cancel;
+    b32 stop;
+    i32 root_best_cell;
+} EndgameSolver;
+
+/**
+ * Negamax search to the end of the game, without evaluation or transposition table
+ * `last_cell` is the cell covered by the previous move, or -1 at the root (the root position is not over)
+ */
+static i32 solve(EndgameSolver *solver, const i32 last_cell, const i32 ply, i32 alpha, i32 beta)
+{
+    Position *pos = &solver->pos;
+    solver->nodes++;
+    if (solver->node_budget != 0 && solver->nodes > solver->node_budget) {
+        solver->stop = true;
+    }
+    else if ((solver->nodes % ENDGAME_CHECK_INTERVAL) == 0 && (get_precise_time() >= solver->deadline || (solver->cancel != NULL && atomic_load_explicit(solver->cancel, memory_order_relaxed)))) {
+        solver->stop = true;
+    }
+    if (solver->stop) {
+        return 0;
+    }
+
+    u16 moves;
+    const PositionOutcome outcome = position_outcome(pos, last_cell, &moves);
+    if (outcome == POSITION_DRAW) {
+        return 0;
+    }
+    if (outcome == POSITION_LOST) {
+        return ply - ENDGAME_WIN;
+    }
+
+    // Take an immediate win, unless it fills the board (it would be a draw)
+    const u16 player_tokens = pos->tokens[pos->side_to_move];
+    const u16 opponent_tokens = pos->tokens[pos->side_to_move ^ 1];
+    const b32 is_last_move = ((player_tokens | opponent_tokens) | moves) == FULL_BOARD_MASK && count_bits(moves) == 1;
+    u16 blocks = 0;
+    for (u16 remaining = moves; remaining != 0; remaining &= remaining - 1) {
+        const i32 cell = __builtin_ctz(remaining);
+        if (!is_last_move && is_winning_cell(player_tokens | CELL_BIT(cell), cell)) {
+            if (ply == 0) {
+                solver->root_best_cell = cell;
+            }
+            return ENDGAME_WIN - (ply + 1);
+        }
+        if (is_winning_cell(opponent_tokens | CELL_BIT(cell), cell)) {
+            blocks |= CELL_BIT(cell);
+        }
+    }
+
+    // Mate distance pruning: the best possible result is a win with the next move
+    if (beta > ENDGAME_WIN - (ply + 1)) {
+        beta = ENDGAME_WIN - (ply + 1);
+        if (alpha >= beta) {
+            return beta;
+        }
+    }
+
+    // Moves that block an immediate win of the opponent are searched first
+    i32 best = -INT_MAX;
+    const u16 ordered_moves[2] = {moves & blocks, moves & ~blocks};
+    for (i32 stage = 0; stage < 2; stage++) {
+        for (u16 remaining = ordered_moves[stage]; remaining != 0; remaining &= remaining - 1) {
+            const i32 cell = __builtin_ctz(remaining);
+            const TileType previous_last_card = position_make_move(pos, cell);
+            const i32 score = -solve(solver, cell, ply + 1, -beta, -alpha);
+            position_unmake_move(pos, cell, previous_last_card);
+            if (solver->stop) {
+                return 0;
+            }
+
+            if (score > best) {
+                best = score;
+                if (ply == 0) {
+                    solver->root_best_cell = cell;
+                }
+            }
+            if (best > alpha) {
+                alpha = best;
+            }
+            if (alpha >= beta) {
+                return best;
+            }
+        }
+    }
+    return best;
+}
+
+/**
+ * Solve a position exactly, for the side to move
+ * The position must not be over, the solver gives up at `deadline`, after `node_budget` nodes (0 for no limit)
+ * or when another thread sets `cancel`, which can be NULL. is_complete is then false
+ */
+EndgameResult solve_endgame(const Position *pos, const f64 deadline, const u64 node_budget, atomic_bool *cancel)
+{
+    EndgameSolver solver = {0};
+    solver.pos = *pos;
+    solver.deadline = deadline;
+    solver.node_budget = node_budget;
+    solver.cancel = cancel;
+    solver.root_best_cell = NO_MOVE;
+
+    const i32 score = solve(&solver, -1, 0, -INT_MAX, INT_MAX);
+
+    EndgameResult result;
+    result.best_cell = solver.root_best_cell;
+    result.nodes = solver.nodes;
+    result.is_complete = !solver.stop;
+    if (score > 0) {
+        result.outcome = OUTCOME_WIN;
+        result.distance = ENDGAME_WIN - score;
+    }
+    else if (score < 0) {
+        result.outcome = OUTCOME_LOSS;
+        result.distance = ENDGAME_WIN + score;
+    }
+    else {
+        // Draws only happen on a full board
+        result.outcome = OUTCOME_DRAW;
+        result.distance = BOARD_CELLS_NB - count_bits(pos->tokens[0] | pos->tokens[1]);
+    }
+    return result;
+}
@@ -0,0 +1,593 @@
+#ifndef PLATFORM_WEB
+#include <pthread.h>
+#endif
+#include <string.h>
+
+#include "game_botbrain.h"
+
+/**
+ * This function scores one winning pattern (a line, a column, a diagonal or a 2x2 square) for a player
+ * Cards that are not covered by a token yet count as empty tiles
+ */
+static i32 evaluate_pattern(const u16 pattern, const u16 player_tokens, const u16 opponent_tokens)
+{
+    // Count the number of empty tiles, player tokens, and opponent tokens ON THE CURRENT PATTERN
+    const i32 count_player = count_bits(player_tokens & pattern);
+    const i32 count_opponent = count_bits(opponent_tokens & pattern);
+    const i32 count_empty = 4 - count_player - count_opponent;
+
+    if (count_player == 4) {
+        return 100; // Make the AI prioritize winning moves
+    }
+    else if (count_opponent == 4) {
+        return -100; // Make the AI avoid losing moves
+    }
+    else if (count_player == 3 && count_empty == 1) {
+        return 10; // Encourage moves that set up future wins
+    }
+    else if (count_player == 2 && count_empty == 2) {
+        return 5; // Encourage moves that make good positions
+    }
+    else if (count_opponent == 3 && count_empty == 1) {
+        return -10; // Encourage blocking opponent's immediate win
+    }
+    else if (count_opponent == 2 && count_empty == 2) {
+        return -5; // Encourage moves that block opponent's potential threats
+    }
+    return 1; // If we put 0, there is an error
+}
+
+/**
+ * This function evaluates all the lines, columns, diagonals and squares of the board and adds or subtracts the score
+ * The score thus corresponds to the "score of the board, is it a good board or not for the player"
+ * `side` is 0 for player 1 and 1 for player 2
+ */
+i32 evaluate_board(const Position *pos, const i32 side)
+{
+    i32 board_score = 0;
+    for (i32 i = 0; i < WIN_PATTERNS_NB; ++i) {
+        board_score += evaluate_pattern(win_patterns[i], pos->tokens[side], pos->tokens[side ^ 1]);
+    }
+    return board_score;
+}
+
+/**
+ * Pattern lookup table: the state of a pattern is the content of its 4 cells in base 3 (0 empty, 1 player 1, 2 player 2),
+ * and pattern_scores[] gives evaluate_pattern() for player 1 minus evaluate_pattern() for player 2 in each of the 81 states
+ */
+static const i16 pattern_scores[PATTERN_STATES_NB] = {
+    0, 0, 0, 0, 10, 0, 0, 0, -10,
+    0, 10, 0, 10, 20, 0, 0, 0, 0,
+    0, 0, -10, 0, 0, 0, -10, 0, -20,
+    0, 10, 0, 10, 20, 0, 0, 0, 0,
+    10, 20, 0, 20, 200, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, -10, 0, 0, 0, -10, 0, -20,
+    0, 0, 0, 0, 0, 0, 0, 0, 0,
+    -10, 0, -20, 0, 0, 0, -20, 0, -200,
+};
+
+// Base 3 value of the 4 bits cell masks of a pattern, with one digit per cell
+static const u8 pattern_ternary[16] = {0, 1, 3, 4, 9, 10, 12, 13, 27, 28, 30, 31, 36, 37, 39, 40};
+
+/**
+ * Gathers the 4 cells of a pattern in bits 12 to 15: (tokens >> shift) & (pattern >> shift) is multiplied by `multiplier`,
+ * which moves each cell to its own bit without any carry. The bit of a cell in the result is its digit in the state of the pattern
+ */
+typedef struct {
+    u8 shift;
+    u16 multiplier;
+} PatternGather;
+
+static const PatternGather pattern_gathers[WIN_PATTERNS_NB] = {
+    // Lines
+    {0, 0x1000}, {4, 0x1000}, {8, 0x1000}, {12, 0x1000},
+    // Columns
+    {0, 0x1248}, {1, 0x1248}, {2, 0x1248}, {3, 0x1248},
+    // Diagonals, the cells of the second one are gathered in reverse order
+    {0, 0x1111}, {3, 0x8888},
+    // 2x2 squares
+    {0, 0x1400}, {1, 0x1400}, {2, 0x1400},
+    {4, 0x1400}, {5, 0x1400}, {6, 0x1400},
+    {8, 0x1400}, {9, 0x1400}, {10, 0x1400},
+};
+
+/**
+ * Value of the digit of each cell in the state of the patterns going through it, in the order of cell_win_patterns[]
+ */
+static const u8 cell_pattern_weights[BOARD_CELLS_NB][CELL_WIN_PATTERNS_MAX] = {
+    {1, 1, 1, 1},
+    {3, 1, 3, 1},
+    {9, 1, 3, 1},
+    {27, 1, 27, 3},
+    {1, 3, 9, 1},
+    {3, 3, 3, 27, 9, 3, 1},
+    {9, 3, 9, 27, 9, 3, 1},
+    {27, 3, 27, 3},
+    {1, 9, 9, 1},
+    {3, 9, 3, 27, 9, 3, 1},
+    {9, 9, 9, 27, 9, 3, 1},
+    {27, 9, 27, 3},
+    {1, 27, 1, 9},
+    {3, 27, 27, 9},
+    {9, 27, 27, 9},
+    {27, 27, 27, 27},
+};
+
+static u32 gather_pattern_cells(const u16 tokens, const i32 pattern)
+{
+    const PatternGather *gather = &pattern_gathers[pattern];
+    const u32 cells = (u32)(tokens & win_patterns[pattern]) >> gather->shift;
+    return ((cells * gather->multiplier) >> 12) & 0xF;
+}
+
+static i32 get_pattern_state(const Position *pos, const i32 pattern)
+{
+    return pattern_ternary[gather_pattern_cells(pos->tokens[0], pattern)] + 2 * pattern_ternary[gather_pattern_cells(pos->tokens[1], pattern)];
+}
+
+/**
+ * Same as evaluate_board(pos, 0) - evaluate_board(pos, 1), with one table lookup per pattern
+ */
+static i32 evaluate_position_scalar(const Position *pos)
+{
+    i32 score = 0;
+    for (i32 i = 0; i < WIN_PATTERNS_NB; i++) {
+        score += pattern_scores[get_pattern_state(pos, i)];
+    }
+    return score;
+}
+
+static void evaluate_tokens_scalar(const u16 *tokens0, const u16 *tokens1, i32 *scores, const u32 positions_nb)
+{
+    for (u32 i = 0; i < positions_nb; i++) {
+        const Position pos = {.tokens = {tokens0[i], tokens1[i]}};
+        scores[i] = evaluate_position_scalar(&pos);
+    }
+}
+
+/**
+ * Vector kernels: lane i counts the tokens of each player in pattern i with a bit count, the lanes after the 19th have an empty pattern
+ * The score of a pattern only depends on the counts: it is f(player 1 count) if player 2 has no token in it,
+ * -f(player 2 count) if player 1 has none, and 0 otherwise, with f = {0, 0, 10, 20, 200} (see pattern_scores[])
+ * Each kernel uses vectors of one register, wider vectors are split by the compiler and spill
+ */
+typedef u16 PatternMasks8 __attribute__((vector_size(8 * sizeof(u16))));
+typedef i16 PatternScores8 __attribute__((vector_size(8 * sizeof(i16))));
+typedef i16 PatternScores4 __attribute__((vector_size(4 * sizeof(i16))));
+typedef u16 PatternMasks16 __attribute__((vector_size(16 * sizeof(u16))));
+typedef i16 PatternScores16 __attribute__((vector_size(16 * sizeof(i16))));
+
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__wasm_simd128__)
+#define HAS_VECTOR_EVALUATION
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(PLATFORM_WEB)
+#define HAS_AVX2_EVALUATION
+#endif
+
+#ifdef HAS_VECTOR_EVALUATION
+// SSE2, NEON and wasm simd128 registers
+static const PatternMasks8 pattern_masks8[3] = {
+    {0x000F, 0x00F0, 0x0F00, 0xF000, 0x1111, 0x2222, 0x4444, 0x8888},
+    {0x8421, 0x1248, 0x0033, 0x0066, 0x00CC, 0x0330, 0x0660, 0x0CC0},
+    {0x3300, 0x6600, 0xCC00},
+};
+#endif
+
+#ifdef HAS_AVX2_EVALUATION
+// AVX2 registers
+static const PatternMasks16 pattern_masks16[2] = {
+    {0x000F, 0x00F0, 0x0F00, 0xF000, 0x1111, 0x2222, 0x4444, 0x8888, 0x8421, 0x1248, 0x0033, 0x0066, 0x00CC, 0x0330, 0x0660, 0x0CC0},
+    {0x3300, 0x6600, 0xCC00},
+};
+#endif
+
+// The vectors are passed by address, passing them by value would depend on the vector ABI of the target
+static inline __attribute__((always_inline)) i32 sum_pattern_scores8(const PatternScores8 *scores)
+{
+    // The sums stay far below the range of 16 bits
+    PatternScores4 halves[2];
+    memcpy(halves, scores, sizeof(*scores));
+    const PatternScores4 half_sum = halves[0] + halves[1];
+
+    i32 score = 0;
+    for (i32 i = 0; i < 4; i++) {
+        score += half_sum[i];
+    }
+    return score;
+}
+
+static inline __attribute__((always_inline)) i32 sum_pattern_scores16(const PatternScores16 *scores)
+{
+    PatternScores8 halves[2];
+    memcpy(halves, scores, sizeof(*scores));
+    const PatternScores8 half_sum = halves[0] + halves[1];
+    return sum_pattern_scores8(&half_sum);
+}
+
+/**
+ * Define the kernels evaluate_position_`suffix`() and evaluate_tokens_`suffix`(), with `lanes` lanes per vector and compiled with `attributes`
+ * The first one scores one pattern per lane, the second one scores one position per lane and loops over the patterns
+ */
+#define DEFINE_VECTOR_EVALUATION(suffix, lanes, attributes)                                                                                          \
+    static inline __attribute__((always_inline)) attributes void add_pattern_scores_##suffix(PatternMasks##lanes *bits, PatternScores##lanes *scores) \
+    {                                                                                                                                                \
+        PatternScores##lanes counts[2];                                                                                                              \
+        for (i32 side = 0; side < 2; side++) {                                                                                                       \
+            bits[side] = bits[side] - ((bits[side] >> 1) & 0x5555);                                                                                  \
+            bits[side] = (bits[side] & 0x3333) + ((bits[side] >> 2) & 0x3333);                                                                       \
+            bits[side] = (bits[side] + (bits[side] >> 4)) & 0x0F0F;                                                                                  \
+            counts[side] = (PatternScores##lanes)((bits[side] + (bits[side] >> 8)) & 0x001F);                                                        \
+        }                                                                                                                                            \
+                                                                                                                                                     \
+        PatternScores##lanes player_scores[2];                                                                                                       \
+        for (i32 side = 0; side < 2; side++) {                                                                                                       \
+            player_scores[side] = ((counts[side] >= 2) & 10) + ((counts[side] >= 3) & 10) + ((counts[side] == 4) & 180);                              \
+        }                                                                                                                                            \
+        *scores += ((counts[1] == 0) & player_scores[0]) - ((counts[0] == 0) & player_scores[1]);                                                    \
+    }                                                                                                                                                \
+                                                                                                                                                     \
+    static attributes i32 evaluate_position_##suffix(const Position *pos)                                                                            \
+    {                                                                                                                                                \
+        PatternScores##lanes scores = {0};                                                                                                           \
+        for (u32 v = 0; v < sizeof(pattern_masks##lanes) / sizeof(pattern_masks##lanes[0]); v++) {                                                   \
+            PatternMasks##lanes bits[2] = {pattern_masks##lanes[v] & pos->tokens[0], pattern_masks##lanes[v] & pos->tokens[1]};                      \
+            add_pattern_scores_##suffix(bits, &scores);                                                                                              \
+        }                                                                                                                                            \
+        return sum_pattern_scores##lanes(&scores);                                                                                                   \
+    }                                                                                                                                                \
+                                                                                                                                                     \
+    static attributes void evaluate_tokens_##suffix(const u16 *tokens0, const u16 *tokens1, i32 *scores, const u32 positions_nb)                     \
+    {                                                                                                                                                \
+        u32 i = 0;                                                                                                                                   \
+        for (; i + lanes <= positions_nb; i += lanes) {                                                                                              \
+            PatternMasks##lanes tokens[2];                                                                                                           \
+            memcpy(&tokens[0], &tokens0[i], sizeof(tokens[0]));                                                                                      \
+            memcpy(&tokens[1], &tokens1[i], sizeof(tokens[1]));                                                                                      \
+            PatternScores##lanes position_scores = {0};                                                                                              \
+            for (i32 pattern = 0; pattern < WIN_PATTERNS_NB; pattern++) {                                                                            \
+                PatternMasks##lanes bits[2] = {tokens[0] & win_patterns[pattern], tokens[1] & win_patterns[pattern]};                                \
+                add_pattern_scores_##suffix(bits, &position_scores);                                                                                 \
+            }                                                                                                                                        \
+            for (i32 lane = 0; lane < lanes; lane++) {                                                                                               \
+                scores[i + lane] = position_scores[lane];                                                                                            \
+            }                                                                                                                                        \
+        }                                                                                                                                            \
+        evaluate_tokens_scalar(&tokens0[i], &tokens1[i], &scores[i], positions_nb - i);                                                              \
+    }
+
+#ifdef HAS_VECTOR_EVALUATION
+DEFINE_VECTOR_EVALUATION(vector, 8, )
+#endif
+
+#ifdef HAS_AVX2_EVALUATION
+DEFINE_VECTOR_EVALUATION(avx2, 16, __attribute__((target("avx2"))))
+#endif
+
+// EvaluationKernel used by evaluate_position(), -1 until the first evaluation picks the fastest one
+static atomic_int evaluation_kernel = -1;
+
+b32 is_evaluation_kernel_supported(const EvaluationKernel kernel)
+{
+    switch (kernel) {
+        case EVALUATION_KERNEL_SCALAR:
+            return true;
+        case EVALUATION_KERNEL_VECTOR:
+#ifdef HAS_VECTOR_EVALUATION
+            return true;
+#else
+            return false;
+#endif
+        case EVALUATION_KERNEL_AVX2:
+#ifdef HAS_AVX2_EVALUATION
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        case EVALUATION_KERNELS_NB:
+            break;
+    }
+    return false;
+}
+
+/**
+ * Make evaluate_position() use `kernel`, this function returns false and keeps the current kernel if the processor does not support it
+ * All the kernels give the same scores
+ */
+b32 set_evaluation_kernel(const EvaluationKernel kernel)
+{
+    if (!is_evaluation_kernel_supported(kernel)) {
+        return false;
+    }
+    atomic_store_explicit(&evaluation_kernel, kernel, memory_order_relaxed);
+    return true;
+}
+
+EvaluationKernel get_evaluation_kernel(void)
+{
+    const i32 kernel = atomic_load_explicit(&evaluation_kernel, memory_order_relaxed);
+    if (kernel >= 0) {
+        return (EvaluationKernel)kernel;
+    }
+
+    EvaluationKernel best_kernel = EVALUATION_KERNEL_SCALAR;
+    if (is_evaluation_kernel_supported(EVALUATION_KERNEL_AVX2)) {
+        best_kernel = EVALUATION_KERNEL_AVX2;
+    }
+    else if (is_evaluation_kernel_supported(EVALUATION_KERNEL_VECTOR)) {
+        best_kernel = EVALUATION_KERNEL_VECTOR;
+    }
+    atomic_store_explicit(&evaluation_kernel, best_kernel, memory_order_relaxed);
+    return best_kernel;
+}
+
+const char *get_evaluation_kernel_name(const EvaluationKernel kernel)
+{
+    switch (kernel) {
+        case EVALUATION_KERNEL_SCALAR:
+            return "scalar";
+        case EVALUATION_KERNEL_VECTOR:
+            return "vector";
+        case EVALUATION_KERNEL_AVX2:
+            return "avx2";
+        case EVALUATION_KERNELS_NB:
+            break;
+    }
+    UNREACHABLE();
+    return "";
+}
+
+/**
+ * Same as evaluate_board(pos, 0) - evaluate_board(pos, 1), with the kernel chosen by set_evaluation_kernel(), or the fastest one
+ */
+i32 evaluate_position(const Position *pos)
+{
+    switch (get_evaluation_kernel()) {
+#ifdef HAS_AVX2_EVALUATION
+        case EVALUATION_KERNEL_AVX2:
+            return evaluate_position_avx2(pos);
+#endif
+#ifdef HAS_VECTOR_EVALUATION
+        case EVALUATION_KERNEL_VECTOR:
+            return evaluate_position_vector(pos);
+#endif
+        default:
+            return evaluate_position_scalar(pos);
+    }
+}
+
+/**
+ * Write evaluate_position() of the positions given as structure of arrays, tokens0[i] and tokens1[i] are the tokens of position i
+ * The vector kernels score one position per lane
+ */
+void evaluate_tokens(const u16 *tokens0, const u16 *tokens1, i32 *scores, const u32 positions_nb)
+{
+    switch (get_evaluation_kernel()) {
+#ifdef HAS_AVX2_EVALUATION
+        case EVALUATION_KERNEL_AVX2:
+            evaluate_tokens_avx2(tokens0, tokens1, scores, positions_nb);
+            break;
+#endif
+#ifdef HAS_VECTOR_EVALUATION
+        case EVALUATION_KERNEL_VECTOR:
+            evaluate_tokens_vector(tokens0, tokens1, scores, positions_nb);
+            break;
+#endif
+        default:
+            evaluate_tokens_scalar(tokens0, tokens1, scores, positions_nb);
+            break;
+    }
+}
+
+/**
+ * Evaluate the positions by blocks of EVALUATION_BLOCK_SIZE, each block is copied to structure of arrays that stay in the L1 cache
+ */
+static void evaluate_position_blocks(const Position *positions, i32 *scores, const u32 positions_nb)
+{
+    u16 tokens[2][EVALUATION_BLOCK_SIZE];
+    for (u32 start = 0; start < positions_nb; start += EVALUATION_BLOCK_SIZE) {
+        const u32 block_size = (positions_nb - start < EVALUATION_BLOCK_SIZE) ? positions_nb - start : EVALUATION_BLOCK_SIZE;
+        for (u32 i = 0; i < block_size; i++) {
+            tokens[0][i] = positions[start + i].tokens[0];
+            tokens[1][i] = positions[start + i].tokens[1];
+        }
+        evaluate_tokens(tokens[0], tokens[1], &scores[start], block_size);
+    }
+}
+
+#ifndef PLATFORM_WEB
+/**
+ * Range of positions evaluated by a helper thread of evaluate_positions()
+ */
+typedef struct {
+    const Position *positions;
+    i32 *scores;
+    u32 positions_nb;
+} EvaluationWorker;
+
+static void *run_evaluation_worker(void *arg)
+{
+    EvaluationWorker *worker = arg;
+    evaluate_position_blocks(worker->positions, worker->scores, worker->positions_nb);
+    return NULL;
+}
+#endif
+
+/**
+ * Write evaluate_position() of each position in `scores`
+ * The positions are split between up to `threads_nb` threads, each thread gets at least EVALUATION_THREAD_MIN_POSITIONS positions
+ */
+void evaluate_positions(const Position *positions, i32 *scores, const u32 positions_nb, const i32 threads_nb)
+{
+    // Make sure that the helper threads do not race to pick the kernel
+    get_evaluation_kernel();
+
+    u32 range_size = positions_nb;
+    i32 started_nb = 0;
+#ifndef PLATFORM_WEB
+    i32 workers_nb = (i32)(positions_nb / EVALUATION_THREAD_MIN_POSITIONS);
+    workers_nb = (workers_nb < threads_nb) ? workers_nb : threads_nb;
+    workers_nb = (workers_nb < BOT_MAX_THREADS) ? workers_nb : BOT_MAX_THREADS;
+
+    // Each thread gets a range of whole blocks
+    pthread_t thread_ids[BOT_MAX_THREADS];
+    EvaluationWorker workers[BOT_MAX_THREADS];
+    if (workers_nb > 1) {
+        range_size = (positions_nb + EVALUATION_BLOCK_SIZE * workers_nb - 1) / (EVALUATION_BLOCK_SIZE * workers_nb) * EVALUATION_BLOCK_SIZE;
+        for (i32 i = 1; i < workers_nb && range_size * i < positions_nb; i++) {
+            const u32 start = range_size * i;
+            workers[i] = (EvaluationWorker){&positions[start], &scores[start], (positions_nb - start < range_size) ? positions_nb - start : range_size};
+            if (pthread_create(&thread_ids[i], NULL, run_evaluation_worker, &workers[i]) != 0) {
+                trace_log(LOG_WARNING, "failed to start an evaluation thread");
+                break;
+            }
+            started_nb = i;
+        }
+    }
+#else
+    (void)threads_nb;
+#endif
+
+    // The calling thread evaluates the first range, and the ranges whose thread did not start
+    evaluate_position_blocks(positions, scores, (range_size < positions_nb) ? range_size : positions_nb);
+    const u32 rest_start = range_size * (u32)(started_nb + 1);
+    if (rest_start < positions_nb) {
+        evaluate_position_blocks(&positions[rest_start], &scores[rest_start], positions_nb - rest_start);
+    }
+
+#ifndef PLATFORM_WEB
+    for (i32 i = 1; i <= started_nb; i++) {
+        pthread_join(thread_ids[i], NULL);
+    }
+#endif
+}
+
+/**
+ * Network inference: the hidden layer has one lane per unit, a vector is one AVX2 register or two SSE2 / NEON / wasm simd128 registers
+ * The vectors are copied from and to the arrays with memcpy(), the arrays have no vector alignment
+ */
+typedef i8 NetworkWeights __attribute__((vector_size(NETWORK_HIDDEN_NB * sizeof(i8))));
+typedef i16 NetworkSums __attribute__((vector_size(NETWORK_HIDDEN_NB * sizeof(i16))));
+typedef i32 NetworkProducts __attribute__((vector_size(NETWORK_HIDDEN_NB * sizeof(i32))));
+typedef i32 NetworkProductsHalf __attribute__((vector_size(NETWORK_HIDDEN_NB / 2 * sizeof(i32))));
+
+// Network scores stay away from the scores of finished games
+#define NETWORK_SCORE_MAX (SCORE_WIN_BOUND / 2)
+
+static inline void add_network_feature(const EvaluationNetwork *network, NetworkSums *hidden, const i32 pattern, const i32 state)
+{
+    NetworkWeights weights;
+    memcpy(&weights, network->feature_weights[pattern * PATTERN_STATES_NB + state], sizeof(weights));
+    *hidden += __builtin_convertvector(weights, NetworkSums);
+}
+
+static inline void remove_network_feature(const EvaluationNetwork *network, NetworkSums *hidden, const i32 pattern, const i32 state)
+{
+    NetworkWeights weights;
+    memcpy(&weights, network->feature_weights[pattern * PATTERN_STATES_NB + state], sizeof(weights));
+    *hidden -= __builtin_convertvector(weights, NetworkSums);
+}
+
+/**
+ * Output of the network for player 1 from its hidden layer
+ * The clipped activations times the int8 output weights fit in 16 bits, they are summed in 32 bits
+ */
+static i32 evaluate_network(const Evaluator *eval)
+{
+    const EvaluationNetwork *network = eval->network;
+    NetworkSums activations;
+    memcpy(&activations, eval->hidden, sizeof(activations));
+    activations &= (activations > 0);
+    const NetworkSums is_clipped = (activations > NETWORK_ACTIVATION_MAX);
+    activations = (activations & ~is_clipped) | (NETWORK_ACTIVATION_MAX & is_clipped);
+
+    NetworkWeights output_weights;
+    memcpy(&output_weights, network->output_weights, sizeof(output_weights));
+    const NetworkProducts products = __builtin_convertvector(activations * __builtin_convertvector(output_weights, NetworkSums), NetworkProducts);
+    NetworkProductsHalf halves[2];
+    memcpy(halves, &products, sizeof(products));
+    const NetworkProductsHalf half_sum = halves[0] + halves[1];
+
+    i32 sum = network->output_bias;
+    for (i32 i = 0; i < NETWORK_HIDDEN_NB / 2; i++) {
+        sum += half_sum[i];
+    }
+    const i32 score = sum >> network->output_shift;
+    return (score > NETWORK_SCORE_MAX) ? NETWORK_SCORE_MAX : (score < -NETWORK_SCORE_MAX) ? -NETWORK_SCORE_MAX : score;
+}
+
+/**
+ * Compute the state of each pattern and the score of `pos` from scratch, with `network` if it is not NULL
+ */
+void evaluator_init(Evaluator *eval, const Position *pos, const EvaluationNetwork *network)
+{
+    eval->network = network;
+    NetworkSums hidden = {0};
+    if (network != NULL) {
+        memcpy(&hidden, network->hidden_biases, sizeof(hidden));
+    }
+
+    for (i32 i = 0; i < WIN_PATTERNS_NB; i++) {
+        eval->states[i] = (u8)get_pattern_state(pos, i);
+        if (network != NULL) {
+            add_network_feature(network, &hidden, i, eval->states[i]);
+        }
+    }
+    memcpy(eval->hidden, &hidden, sizeof(hidden));
+}
+
+/**
+ * Swap the network features of the patterns going through `cell`, whose states have just changed by `delta` times the digit of the cell
+ */
+static void update_network_features(Evaluator *eval, const i32 cell, const i32 delta)
+{
+    const CellWinPatterns *cell_patterns = &cell_win_patterns[cell];
+    NetworkSums hidden;
+    memcpy(&hidden, eval->hidden, sizeof(hidden));
+    for (i32 i = 0; i < cell_patterns->count; i++) {
+        const i32 pattern = cell_patterns->patterns[i];
+        remove_network_feature(eval->network, &hidden, pattern, eval->states[pattern] - cell_pattern_weights[cell][i] * delta);
+        add_network_feature(eval->network, &hidden, pattern, eval->states[pattern]);
+    }
+    memcpy(eval->hidden, &hidden, sizeof(hidden));
+}
+
+/**
+ * Update the evaluation after `side` has covered `cell`, only the patterns going through the cell change
+ * Without a network nothing is updated, evaluate_position() scores a leaf from scratch faster than the states are kept up to date at every node
+ */
+void evaluator_add_token(Evaluator *eval, const i32 side, const i32 cell)
+{
+    if (eval->network == NULL) {
+        return;
+    }
+    const CellWinPatterns *cell_patterns = &cell_win_patterns[cell];
+    for (i32 i = 0; i < cell_patterns->count; i++) {
+        eval->states[cell_patterns->patterns[i]] += cell_pattern_weights[cell][i] * (side + 1);
+    }
+    update_network_features(eval, cell, side + 1);
+}
+
+/**
+ * Undo evaluator_add_token()
+ */
+void evaluator_remove_token(Evaluator *eval, const i32 side, const i32 cell)
+{
+    if (eval->network == NULL) {
+        return;
+    }
+    const CellWinPatterns *cell_patterns = &cell_win_patterns[cell];
+    for (i32 i = 0; i < cell_patterns->count; i++) {
+        eval->states[cell_patterns->patterns[i]] -= cell_pattern_weights[cell][i] * (side + 1);
+    }
+    update_network_features(eval, cell, -(side + 1));
+}
+
+/**
+ * Score of `pos`, the position of `eval`, for `side`: evaluate_board(pos, side) - evaluate_board(pos, side ^ 1), or the network output
+ */
+i32 evaluator_score(const Evaluator *eval, const Position *pos, const i32 side)
+{
+    const i32 score = (eval->network != NULL) ? evaluate_network(eval) : evaluate_position(pos);
+    return (side == 0) ? score : -score;
+}
@@ -1,16 +1,38 @@
 #include "game.h"
 
+/**
+ * Colors shown by the cards, indexed with CARD_FIRST_COLOR() and CARD_SECOND_COLOR()
+ */
+static const Color card_colors[CARD_COLORS_NB] = {BLUE, YELLOW, ORANGE, SKYBLUE, RED, PURPLE, GREEN, BROWN};
+
+/**
+ * Two cards can follow each other when they share their first or their second color
+ * Bit n of card_compatibility[card] is set when the card n can be taken after `card`
+ */
+#define CARD_COMPATIBILITY(card) ((u16)((0x000F << (CARD_FIRST_COLOR(card) * 4)) | (0x1111 << (CARD_SECOND_COLOR(card) - 4))))
+const u16 card_compatibility[CARD_TYPES_NB] = {
+    CARD_COMPATIBILITY(CARD_BLUE_RED),
+    CARD_COMPATIBILITY(CARD_BLUE_PURPLE),
+    CARD_COMPATIBILITY(CARD_BLUE_GREEN),
+    CARD_COMPATIBILITY(CARD_BLUE_BROWN),
+    CARD_COMPATIBILITY(CARD_YELLOW_RED),
+    CARD_COMPATIBILITY(CARD_YELLOW_PURPLE),
+    CARD_COMPATIBILITY(CARD_YELLOW_GREEN),
+    CARD_COMPATIBILITY(CARD_YELLOW_BROWN),
+    CARD_COMPATIBILITY(CARD_ORANGE_RED),
+    CARD_COMPATIBILITY(CARD_ORANGE_PURPLE),
+    CARD_COMPATIBILITY(CARD_ORANGE_GREEN),
+    CARD_COMPATIBILITY(CARD_ORANGE_BROWN),
+    CARD_COMPATIBILITY(CARD_SKYBLUE_RED),
+    CARD_COMPATIBILITY(CARD_SKYBLUE_PURPLE),
+    CARD_COMPATIBILITY(CARD_SKYBLUE_GREEN),
+    CARD_COMPATIBILITY(CARD_SKYBLUE_BROWN),
+};
+
 b32 have_common_color(const TileType tile1_type, const TileType tile2_type)
 {
-    Color color1_card1 = get_tile_color(tile1_type, 1);
-    Color color2_card1 = get_tile_color(tile1_type, 2);
-    Color color1_card2 = get_tile_color(tile2_type, 1);
-    Color color2_card2 = get_tile_color(tile2_type, 2);
-
-    return (color1_card1.r == color1_card2.r && color1_card1.g == color1_card2.g && color1_card1.b == color1_card2.b) ||
-           (color1_card1.r == color2_card2.r && color1_card1.g == color2_card2.g && color1_card1.b == color2_card2.b) ||
-           (color2_card1.r == color1_card2.r && color2_card1.g == color1_card2.g && color2_card1.b == color1_card2.b) ||
-           (color2_card1.r == color2_card2.r && color2_card1.g == color2_card2.g && color2_card1.b == color2_card2.b);
+    ASSERT(tile1_type < CARD_TYPES_NB && tile2_type < CARD_TYPES_NB, "Both tiles should be cards");
+    return (card_compatibility[tile2_type] >> tile1_type) & 1;
 }
 
 b32 is_board_full(const Tile board[][BOARD_COLUMNS_NB])
@@ -28,80 +50,33 @@ b32 is_board_full(const Tile board[][BOARD_COLUMNS_NB])
 
 static b32 is_winner(const Player player, GameLogicData *game)
 {
-    TileType player_token_type;
+    i32 player_side;
     if (player == PLAYER1) {
-        player_token_type = TOKEN_PLAYER1;
+        player_side = 0;
     }
     else if (player == PLAYER2) {
-        player_token_type = TOKEN_PLAYER2;
+        player_side = 1;
     }
     else {
         UNREACHABLE();
+        player_side = 0;
     }
 
+    const Position pos = position_from_board(game->board, rendering_data->stack_top_card_ui.type, player);
+
     // if board full, do not return winner
-    if (is_board_full(game->board)) {
+    if (position_is_full(&pos)) {
         return false;
     }
 
-    // Check horizontal and vertical lines
-    for (i32 i = 0; i < BOARD_ROWS_NB; i++) {
-        b32 horizontal_win = true;
-        b32 vertical_win = true;
-        for (i32 j = 0; j < BOARD_COLUMNS_NB; j++) {
-            if (game->board[i][j].type != player_token_type) {
-                horizontal_win = false;
-            }
-            if (game->board[j][i].type != player_token_type) {
-                vertical_win = false;
-            }
-        }
-        if (horizontal_win || vertical_win) {
-            return true;
-        }
-    }
-
-    // Check 2x2 squares
-    for (i32 i = 0; i < BOARD_ROWS_NB - 1; i++) {
-        for (i32 j = 0; j < BOARD_COLUMNS_NB - 1; j++) {
-            if (game->board[i][j].type == player_token_type && game->board[i][j + 1].type == player_token_type &&
-                game->board[i + 1][j].type == player_token_type && game->board[i + 1][j + 1].type == player_token_type) {
-                return true;
-            }
-        }
-    }
-
-    // Check diagonals
-    b32 diagonal1_win = true;
-    b32 diagonal2_win = true;
-    for (i32 i = 0; i < BOARD_ROWS_NB; i++) {
-        if (game->board[i][i].type != player_token_type) {
-            diagonal1_win = false;
-        }
-        if (game->board[i][BOARD_ROWS_NB - 1 - i].type != player_token_type) {
-            diagonal2_win = false;
-        }
-    }
-    if (diagonal1_win || diagonal2_win) {
+    // Check lines, columns, diagonals and 2x2 squares
+    if (has_winning_pattern(pos.tokens[player_side])) {
         return true;
     }
 
     // Check if the next player can play
-    for (i32 i = 0; i < BOARD_ROWS_NB; i++) {
-        for (i32 j = 0; j < BOARD_COLUMNS_NB; j++) {
-            const b32 tile_is_a_card = game->board[i][j].type != TOKEN_PLAYER1 && game->board[i][j].type != TOKEN_PLAYER2;
-            if (game->stack_top_card.type != EMPTY_TILE) {
-                if (tile_is_a_card && have_common_color(game->board[i][j].type, rendering_data->stack_top_card_ui.type)) {
-                    return false;
-                }
-                else {
-                    continue;
-                }
-            }
-            else {
-                return false;
-            }
-        }
+    if (game->stack_top_card.type == EMPTY_TILE || position_legal_moves(&pos) != 0) {
+        return false;
     }
 
     if (game->current_player == PLAYER1) {
@@ -167,6 +142,11 @@ static Vec2i get_next_token_placement(GameLogicData *game)
     // One player game
     if (game->mode == MODE_ONE_PLAYER) {
         if (game->current_player == PLAYER1) {
+            // The bot searches its replies while the human thinks
+            if (game->bot_ponder == NULL && is_token_placement_animation_running() == false) {
+                game->bot_ponder = start_bot_ponder(game->board, game->stack_top_card, &game->bot_settings, game->bot_memory);
+            }
+
             for (i32 i = 0; i < 4; i++) {
                 for (i32 j = 0; j < 4; j++) {
                     Vec2i tile_coord = (Vec2i){i, j};
@@ -181,7 +161,19 @@ static Vec2i get_next_token_placement(GameLogicData *game)
         }
         else if (game->current_player == PLAYER2 && game->ai_thinking_duration <= 0.0f && is_token_placement_animation_running() == false) {
             game->ai_thinking_duration = 0.0f;
-            Vec2i pressed_tile = get_ai_pressed_tile(game->board, game->stack_top_card);
+
+            // The bot searches on another thread, the frames go on until its move is ready
+            if (game->bot_search == NULL) {
+                game->bot_search = start_bot_search(game->board, game->stack_top_card, &game->bot_settings, game->bot_memory, game->bot_ponder);
+                game->bot_ponder = NULL;
+            }
+            Vec2i pressed_tile;
+            if (poll_bot_search(game->bot_search, &pressed_tile) == false) {
+                return (Vec2i){-1, -1};
+            }
+            stop_bot_search(game->bot_search);
+            game->bot_search = NULL;
+
             if (is_token_placement_valid(pressed_tile, game, &game->info_message_p2)) {
                 return pressed_tile;
             }
@@ -244,81 +236,13 @@ static void update_tiles_pressed_state(Tile board[][BOARD_COLUMNS_NB])
 
 Color get_tile_color(const TileType tile_type, const i32 color_number)
 {
+    ASSERT(tile_type < CARD_TYPES_NB, "The tile should be a card");
+
     if (color_number == 1) {
-        switch (tile_type) {
-            case CARD_BLUE_RED:
-                return BLUE;
-            case CARD_BLUE_PURPLE:
-                return BLUE;
-            case CARD_BLUE_GREEN:
-                return BLUE;
-            case CARD_BLUE_BROWN:
-                return BLUE;
-            case CARD_YELLOW_RED:
-                return YELLOW;
-            case CARD_YELLOW_PURPLE:
-                return YELLOW;
-            case CARD_YELLOW_GREEN:
-                return YELLOW;
-            case CARD_YELLOW_BROWN:
-                return YELLOW;
-            case CARD_ORANGE_RED:
-                return ORANGE;
-            case CARD_ORANGE_PURPLE:
-                return ORANGE;
-            case CARD_ORANGE_GREEN:
-                return ORANGE;
-            case CARD_ORANGE_BROWN:
-                return ORANGE;
-            case CARD_SKYBLUE_RED:
-                return SKYBLUE;
-            case CARD_SKYBLUE_PURPLE:
-                return SKYBLUE;
-            case CARD_SKYBLUE_GREEN:
-                return SKYBLUE;
-            case CARD_SKYBLUE_BROWN:
-                return SKYBLUE;
-            default:
-                UNREACHABLE();
-        }
+        return card_colors[CARD_FIRST_COLOR(tile_type)];
     }
     else if (color_number == 2) {
-        switch (tile_type) {
-            case CARD_BLUE_RED:
-                return RED;
-            case CARD_BLUE_PURPLE:
-                return PURPLE;
-            case CARD_BLUE_GREEN:
-                return GREEN;
-            case CARD_BLUE_BROWN:
-                return BROWN;
-            case CARD_YELLOW_RED:
-                return RED;
-            case CARD_YELLOW_PURPLE:
-                return PURPLE;
-            case CARD_YELLOW_GREEN:
-                return GREEN;
-            case CARD_YELLOW_BROWN:
-                return BROWN;
-            case CARD_ORANGE_RED:
-                return RED;
-            case CARD_ORANGE_PURPLE:
-                return PURPLE;
-            case CARD_ORANGE_GREEN:
-                return GREEN;
-            case CARD_ORANGE_BROWN:
-                return BROWN;
-            case CARD_SKYBLUE_RED:
-                return RED;
-            case CARD_SKYBLUE_PURPLE:
-                return PURPLE;
-            case CARD_SKYBLUE_GREEN:
-                return GREEN;
-            case CARD_SKYBLUE_BROWN:
-                return BROWN;
-            default:
-                UNREACHABLE();
-        }
+        return card_colors[CARD_SECOND_COLOR(tile_type)];
     }
     UNREACHABLE();
     return WHITE;   // Here to remove warnings
@@ -390,7 +314,7 @@ void update_game_logic(GameLogicData *game, GameAnimationsData *game_animations_
             // Switch player
             if (game->current_player == PLAYER1) {
                 if (game->mode == MODE_ONE_PLAYER) {
-                    game->ai_thinking_duration = 4.0f;
+                    game->ai_thinking_duration = game->bot_settings.reply_delay;
                 }
                 game->current_player = PLAYER2;
             }
@@ -416,6 +340,10 @@ void update_game_logic(GameLogicData *game, GameAnimationsData *game_animations_
         update_tiles_pressed_state(game->board);
     }
     else if (game->game_state == GAME_STATE_WIN || game->game_state == GAME_STATE_DRAW) {
+        // The last human move ended the game, no reply is needed
+        stop_bot_ponder(game->bot_ponder);
+        game->bot_ponder = NULL;
+
         if (is_released(game->home_button.is_pressed)) {
             game->order = GO_TO_MENU;
             game->home_button.is_pressed = false;
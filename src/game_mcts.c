@@ -0,0 +1,494 @@
+#ifndef PLATFORM_WEB
+#include <pthread.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "game_botbrain.h"
+
+// The time budget and the cancel flag are checked once every MCTS_CHECK_INTERVAL iterations
+#define MCTS_CHECK_INTERVAL 64
+
+// The new root of a reused tree is at most this number of moves below the old one: the bot move and the human reply
+#define MCTS_REUSE_MAX_PLIES 2
+
+static void init_mcts_arena(MctsArena *arena, const u32 capacity)
+{
+    arena->nodes = (MctsNode *)malloc(sizeof(MctsNode) * capacity);
+    if (arena->nodes == NULL) {
+        application_panic(__FILE__, __LINE__, "Memory allocation failed");
+    }
+    arena->capacity = capacity;
+    atomic_init(&arena->used, 0);
+}
+
+/**
+ * Take `count` contiguous nodes from the arena, several threads can allocate at the same time
+ * This function returns false if the arena is full, the tree then stops growing
+ */
+static b32 alloc_mcts_nodes(MctsArena *arena, const u32 count, u32 *first)
+{
+    u32 used = atomic_load_explicit(&arena->used, memory_order_relaxed);
+    do {
+        if (arena->capacity - used < count) {
+            return false;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&arena->used, &used, used + count, memory_order_relaxed, memory_order_relaxed));
+    *first = used;
+    return true;
+}
+
+static void free_mcts_arena(MctsArena *arena)
+{
+    free(arena->nodes);
+    arena->nodes = NULL;
+    arena->capacity = 0;
+    atomic_store(&arena->used, 0);
+}
+
+static void init_mcts_node(MctsNode *node, const i32 cell, const MctsOutcome outcome)
+{
+    node->first_child = 0;
+    node->children_nb = 0;
+    node->cell = (u8)cell;
+    node->outcome = (u8)outcome;
+    atomic_init(&node->state, MCTS_UNEXPANDED);
+    atomic_init(&node->visits, 0);
+    atomic_init(&node->score, 0);
+}
+
+/**
+ * Outcome of the move `cell` that has just been played
+ */
+static MctsOutcome get_move_outcome(const Position *pos, const i32 cell)
+{
+    u16 moves;
+    switch (position_outcome(pos, cell, &moves)) {
+        case POSITION_DRAW:
+            return MCTS_DRAW;
+        case POSITION_LOST:
+            return MCTS_WIN;
+        case POSITION_ONGOING:
+            break;
+    }
+    return MCTS_ONGOING;
+}
+
+/**
+ * Create the children of `node`, one per legal move of `pos`
+ * The calling thread must own the expansion of the node (state MCTS_EXPANDING), the children are published with the state
+ * This function returns false if the arena is full
+ */
+static b32 expand_mcts_node(MctsArena *arena, MctsNode *node, const Position *pos)
+{
+    const u16 moves = position_legal_moves(pos);
+    u32 first_child;
+    if (!alloc_mcts_nodes(arena, count_bits(moves), &first_child)) {
+        return false;
+    }
+
+    MctsNode *child = &arena->nodes[first_child];
+    for (u16 remaining = moves; remaining != 0; remaining &= remaining - 1, child++) {
+        const i32 cell = __builtin_ctz(remaining);
+        Position child_pos = *pos;
+        position_make_move(&child_pos, cell);
+        init_mcts_node(child, cell, get_move_outcome(&child_pos, cell));
+    }
+
+    node->first_child = first_child;
+    node->children_nb = (u8)count_bits(moves);
+    atomic_store_explicit(&node->state, MCTS_EXPANDED, memory_order_release);
+    return true;
+}
+
+/**
+ * UCT: pick the child with the best upper confidence bound of its score, a child never visited comes first
+ */
+static MctsNode *select_mcts_child(const MctsSearch *search, const MctsNode *node)
+{
+    MctsNode *children = &search->tree->arena.nodes[node->first_child];
+    const f64 log_visits = log((f64)atomic_load_explicit(&node->visits, memory_order_relaxed));
+    const f64 exploration = search->settings->mcts_exploration;
+
+    MctsNode *best_child = children;
+    f64 best_value = -1.0;
+    for (i32 i = 0; i < node->children_nb; i++) {
+        const u32 visits = atomic_load_explicit(&children[i].visits, memory_order_relaxed);
+        if (visits == 0) {
+            return &children[i];
+        }
+        const f64 mean = (f64)atomic_load_explicit(&children[i].score, memory_order_relaxed) / (2.0 * visits);
+        const f64 value = mean + exploration * sqrt(log_visits / visits);
+        if (value > best_value) {
+            best_value = value;
+            best_child = &children[i];
+        }
+    }
+    return best_child;
+}
+
+/**
+ * Score the leaf `pos` with a random playout, or a batch of them, and return the number of playouts
+ * `half_points` receives the half points of each player
+ */
+static u32 run_mcts_playouts(const MctsSearch *search, const Position *pos, u64 *random_state, u32 half_points[2])
+{
+    if (search->settings->batched_playouts) {
+        PlayoutResults results = {{0, 0}, 0};
+        run_playout_batch(pos, random_state, &results);
+        half_points[0] = 2 * results.wins[0] + results.draws;
+        half_points[1] = 2 * results.wins[1] + results.draws;
+        return get_playout_batch_size();
+    }
+
+    Position playout_pos = *pos;
+    const i32 winner = random_playout(&playout_pos, random_state);
+    half_points[0] = (winner == PLAYOUT_DRAW) ? 1 : (winner == 0) * 2;
+    half_points[1] = (winner == PLAYOUT_DRAW) ? 1 : (winner == 1) * 2;
+    return 1;
+}
+
+/**
+ * One MCTS iteration: select a path with UCT, expand its leaf, score it with random playouts and add their results to the nodes of the path
+ * This function returns the number of playouts, and writes the depth of the path in `depth`
+ */
+static u32 run_mcts_iteration(MctsSearch *search, u64 *random_state, i32 *depth)
+{
+    MctsArena *arena = &search->tree->arena;
+    Position pos = search->root;
+    MctsNode *path[MAX_PLY + 1];
+    i32 path_nb = 0;
+
+    MctsNode *node = &arena->nodes[0];
+    u32 previous_visits = atomic_fetch_add_explicit(&node->visits, 1, memory_order_relaxed);
+    path[path_nb++] = node;
+
+    // A finished game counts as many playouts as a leaf, so that both weigh the same
+    const u32 playouts_nb = search->settings->batched_playouts ? get_playout_batch_size() : 1;
+    u32 half_points[2];
+
+    while (true) {
+        if (node->outcome == MCTS_WIN) {
+            half_points[pos.side_to_move ^ 1] = 2 * playouts_nb;
+            half_points[pos.side_to_move] = 0;
+            break;
+        }
+        if (node->outcome == MCTS_DRAW) {
+            half_points[0] = playouts_nb;
+            half_points[1] = playouts_nb;
+            break;
+        }
+
+        // A leaf is expanded at its second visit, the first one only gives its playout
+        if (atomic_load_explicit(&node->state, memory_order_acquire) != MCTS_EXPANDED) {
+            u8 expected = MCTS_UNEXPANDED;
+            if (previous_visits == 0 || !atomic_compare_exchange_strong(&node->state, &expected, MCTS_EXPANDING)) {
+                run_mcts_playouts(search, &pos, random_state, half_points);
+                break;
+            }
+            if (!expand_mcts_node(arena, node, &pos)) {
+                atomic_store(&node->state, MCTS_UNEXPANDED);
+                run_mcts_playouts(search, &pos, random_state, half_points);
+                break;
+            }
+        }
+
+        node = select_mcts_child(search, node);
+        previous_visits = atomic_fetch_add_explicit(&node->visits, 1, memory_order_relaxed);
+        position_make_move(&pos, node->cell);
+        path[path_nb++] = node;
+    }
+
+    // The root is entered by the player who does not move at the root, then the players alternate
+    // One visit was counted during the selection, the other playouts of a batch are counted now
+    for (i32 i = 0; i < path_nb; i++) {
+        const i32 mover = search->root.side_to_move ^ ((i & 1) ? 0 : 1);
+        if (playouts_nb > 1) {
+            atomic_fetch_add_explicit(&path[i]->visits, playouts_nb - 1, memory_order_relaxed);
+        }
+        atomic_fetch_add_explicit(&path[i]->score, half_points[mover], memory_order_relaxed);
+    }
+    *depth = path_nb - 1;
+    return playouts_nb;
+}
+
+/**
+ * Run iterations until the search is over or `end_time` is reached, the budget of the search ends at `deadline`
+ * Every thread of the search runs this function, with its own random state
+ */
+static void run_mcts_iterations(MctsSearch *search, u64 *random_state, const f64 end_time, const f64 deadline, u64 *playouts, i32 *tree_depth)
+{
+    const u64 playout_budget = search->settings->playout_budget;
+    const u32 batch_size = search->settings->batched_playouts ? get_playout_batch_size() : 1;
+    for (u64 i = 0; !atomic_load_explicit(&search->stop, memory_order_relaxed); i++) {
+        if ((i % MCTS_CHECK_INTERVAL) == 0) {
+            const f64 now = get_precise_time();
+            if (now >= deadline || (search->cancel != NULL && atomic_load_explicit(search->cancel, memory_order_relaxed))) {
+                atomic_store_explicit(&search->stop, true, memory_order_relaxed);
+                break;
+            }
+            if (now >= end_time) {
+                break;
+            }
+        }
+        if (playout_budget != 0 && atomic_fetch_add_explicit(&search->started_playouts, batch_size, memory_order_relaxed) >= playout_budget) {
+            atomic_store_explicit(&search->stop, true, memory_order_relaxed);
+            break;
+        }
+
+        i32 depth;
+        *playouts += run_mcts_iteration(search, random_state, &depth);
+        if (depth > *tree_depth) {
+            *tree_depth = depth;
+        }
+    }
+}
+
+MctsTree *create_mcts_tree(const BotSettings *settings)
+{
+    MctsTree *tree;
+    ASSERT(settings->mcts_arena_nodes > BOARD_CELLS_NB, "The MCTS arena should hold the root and its children");
+    ALLOC_VAR(tree, MctsTree);
+    init_mcts_arena(&tree->arena, settings->mcts_arena_nodes);
+    return tree;
+}
+
+void destroy_mcts_tree(MctsTree *tree)
+{
+    if (tree == NULL) {
+        return;
+    }
+    free_mcts_arena(&tree->arena);
+    free_mcts_arena(&tree->spare);
+    free(tree);
+}
+
+static b32 is_same_position(const Position *a, const Position *b)
+{
+    return a->key == b->key && a->tokens[0] == b->tokens[0] && a->tokens[1] == b->tokens[1] && a->last_card == b->last_card && a->side_to_move == b->side_to_move;
+}
+
+/**
+ * Look for `pos` in the tree, at most `max_plies` moves below `node`
+ * This function returns the index of its node, or -1 if the tree does not have it
+ */
+static i32 find_mcts_node(const MctsArena *arena, const u32 node_index, const Position *node_pos, const Position *pos, const i32 max_plies)
+{
+    if (is_same_position(node_pos, pos)) {
+        return node_index;
+    }
+    const MctsNode *node = &arena->nodes[node_index];
+    if (max_plies == 0 || atomic_load(&node->state) != MCTS_EXPANDED) {
+        return -1;
+    }
+
+    for (u32 i = node->first_child; i < node->first_child + node->children_nb; i++) {
+        Position child_pos = *node_pos;
+        position_make_move(&child_pos, arena->nodes[i].cell);
+        const i32 found = find_mcts_node(arena, i, &child_pos, pos, max_plies - 1);
+        if (found >= 0) {
+            return found;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Copy the subtree of `node_index` to the spare arena, breadth first so that the children stay contiguous, then swap the arenas
+ * The copied nodes keep the old index of their children until they are themselves visited
+ */
+static void keep_mcts_subtree(MctsTree *tree, const u32 node_index)
+{
+    MctsArena *from = &tree->arena;
+    MctsArena *to = &tree->spare;
+    if (to->nodes == NULL) {
+        init_mcts_arena(to, from->capacity);
+    }
+
+    to->nodes[0] = from->nodes[node_index];
+    u32 used = 1;
+    for (u32 i = 0; i < used; i++) {
+        MctsNode *node = &to->nodes[i];
+        if (atomic_load(&node->state) != MCTS_EXPANDED) {
+            atomic_store(&node->state, MCTS_UNEXPANDED);
+            continue;
+        }
+        memcpy(&to->nodes[used], &from->nodes[node->first_child], sizeof(MctsNode) * node->children_nb);
+        node->first_child = used;
+        used += node->children_nb;
+    }
+    atomic_store(&to->used, used);
+
+    const MctsArena swap = *from;
+    *from = *to;
+    *to = swap;
+}
+
+/**
+ * Make `pos` the root of the tree, keeping its subtree if the tree already searched it
+ */
+static void set_mcts_tree_root(MctsTree *tree, const Position *pos)
+{
+    const i32 found = tree->has_root ? find_mcts_node(&tree->arena, 0, &tree->root, pos, MCTS_REUSE_MAX_PLIES) : -1;
+    if (found > 0) {
+        keep_mcts_subtree(tree, (u32)found);
+    }
+    else if (found < 0) {
+        atomic_store(&tree->arena.used, 1);
+        init_mcts_node(&tree->arena.nodes[0], NO_MOVE, MCTS_ONGOING);
+    }
+    tree->root = *pos;
+    tree->has_root = true;
+}
+
+/**
+ * Prepare the search of the best move of `pos`, run_mcts_search() then searches it slice by slice
+ * The search starts from what `tree` kept of the earlier searches, or from a tree of its own if `tree` is NULL
+ * `settings` must stay valid until the search is freed
+ */
+void init_mcts_search(MctsSearch *search, const Position *pos, const BotSettings *settings, MctsTree *tree, atomic_bool *cancel)
+{
+    ASSERT(position_legal_moves(pos) != 0, "The bot should have a move to play");
+
+    search->root = *pos;
+    search->settings = settings;
+    search->cancel = cancel;
+    search->is_tree_owner = (tree == NULL);
+    search->tree = (tree != NULL) ? tree : create_mcts_tree(settings);
+    search->random_state = pos->key | 1;
+    atomic_init(&search->started_playouts, 0);
+    atomic_init(&search->stop, false);
+    search->playouts = 0;
+    search->tree_depth = 0;
+    search->time_left = settings->time_budget;
+    search->is_done = false;
+
+    set_mcts_tree_root(search->tree, pos);
+    search->reused_visits = atomic_load(&search->tree->arena.nodes[0].visits);
+}
+
+/**
+ * Search on the calling thread for `slice_time` seconds at most, and return true once the playout or time budget is exhausted
+ */
+b32 run_mcts_search(MctsSearch *search, const f64 slice_time)
+{
+    if (search->is_done) {
+        return true;
+    }
+
+    const f64 start_time = get_precise_time();
+    run_mcts_iterations(search, &search->random_state, start_time + slice_time, start_time + search->time_left, &search->playouts, &search->tree_depth);
+
+    search->time_left -= get_precise_time() - start_time;
+    search->is_done = atomic_load(&search->stop);
+    return search->is_done;
+}
+
+/**
+ * The most visited root move is the best one, its score is the most reliable
+ */
+i32 get_mcts_best_move(const MctsSearch *search)
+{
+    const MctsNode *root = &search->tree->arena.nodes[0];
+    if (atomic_load(&root->state) != MCTS_EXPANDED) {
+        return __builtin_ctz(position_legal_moves(&search->root));
+    }
+
+    const MctsNode *children = &search->tree->arena.nodes[root->first_child];
+    const MctsNode *best_child = children;
+    for (i32 i = 1; i < root->children_nb; i++) {
+        if (atomic_load(&children[i].visits) > atomic_load(&best_child->visits)) {
+            best_child = &children[i];
+        }
+    }
+    return best_child->cell;
+}
+
+void free_mcts_search(MctsSearch *search)
+{
+    if (search->is_tree_owner) {
+        destroy_mcts_tree(search->tree);
+    }
+    search->tree = NULL;
+}
+
+#ifndef PLATFORM_WEB
+/**
+ * Helper thread of a parallel MCTS, it runs iterations on the shared tree until the calling thread stops the search
+ */
+typedef struct {
+    MctsSearch *search;
+    u64 random_state;
+    f64 deadline;
+    u64 playouts;
+    i32 tree_depth;
+} MctsWorker;
+
+static void *run_mcts_worker(void *arg)
+{
+    MctsWorker *worker = arg;
+    run_mcts_iterations(worker->search, &worker->random_state, worker->deadline, worker->deadline, &worker->playouts, &worker->tree_depth);
+    return NULL;
+}
+#endif
+
+/**
+ * Search the best move of `pos` with MCTS, within the playout and time budgets of `settings`
+ * With settings.threads above 1, the helper threads search the same tree as the calling thread
+ * `tree` can be NULL, the search then starts from an empty tree
+ */
+i32 search_mcts(const Position *pos, const BotSettings *settings, MctsTree *tree, atomic_bool *cancel, SearchStats *stats)
+{
+    const f64 start_time = get_precise_time();
+    const f64 deadline = start_time + settings->time_budget;
+    MctsSearch search;
+    init_mcts_search(&search, pos, settings, tree, cancel);
+
+    u64 thread_playouts[BOT_MAX_THREADS] = {0};
+    i32 threads_nb = 1;
+#ifndef PLATFORM_WEB
+    pthread_t thread_ids[BOT_MAX_THREADS];
+    MctsWorker workers[BOT_MAX_THREADS];
+    for (i32 i = 1; i < settings->threads && i < BOT_MAX_THREADS; i++) {
+        workers[i] = (MctsWorker){&search, (pos->key ^ (0x9E3779B97F4A7C15ULL * i)) | 1, deadline, 0, 0};
+        if (pthread_create(&thread_ids[i], NULL, run_mcts_worker, &workers[i]) != 0) {
+            trace_log(LOG_WARNING, "failed to start a search thread");
+            break;
+        }
+        threads_nb++;
+    }
+#endif
+
+    run_mcts_iterations(&search, &search.random_state, deadline, deadline, &thread_playouts[0], &search.tree_depth);
+    atomic_store(&search.stop, true);
+    search.playouts = thread_playouts[0];
+
+#ifndef PLATFORM_WEB
+    for (i32 i = 1; i < threads_nb; i++) {
+        pthread_join(thread_ids[i], NULL);
+        thread_playouts[i] = workers[i].playouts;
+        search.playouts += workers[i].playouts;
+        if (workers[i].tree_depth > search.tree_depth) {
+            search.tree_depth = workers[i].tree_depth;
+        }
+    }
+#endif
+
+    const i32 best_cell = get_mcts_best_move(&search);
+    trace_log(LOG_DEBUG, "mcts: best tile {row: %d, col: %d}, %llu playouts on %d threads, %u nodes, depth %d", best_cell % BOARD_COLUMNS_NB + 1, best_cell / BOARD_COLUMNS_NB + 1, search.playouts, threads_nb, atomic_load(&search.tree->arena.used), search.tree_depth);
+
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+        stats->best_cell = best_cell;
+        stats->depth = search.tree_depth;
+        stats->nodes = search.playouts;
+        stats->threads = threads_nb;
+        memcpy(stats->thread_nodes, thread_playouts, sizeof(thread_playouts));
+        stats->time = get_precise_time() - start_time;
+        stats->mcts_reused = search.reused_visits;
+    }
+
+    free_mcts_search(&search);
+    return best_cell;
+}
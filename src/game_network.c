@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game_botbrain.h"
+
+/**
+ * Network file: the magic "D4NN", the version, the numbers of features and hidden units as u32,
+ * then the feature weights (i8, one row of hidden units per feature), the hidden biases (i16), the output weights (i8),
+ * the output bias and the output shift (i32). All the numbers are little endian
+ */
+#define NETWORK_FILE_MAGIC "D4NN"
+#define NETWORK_FILE_VERSION 1
+#define NETWORK_MAX_OUTPUT_SHIFT 24
+
+static void write_u32(u8 *bytes, const u32 value)
+{
+    for (i32 i = 0; i < 4; i++) {
+        bytes[i] = (u8)(value >> (8 * i));
+    }
+}
+
+static u32 read_u32(const u8 *bytes)
+{
+    u32 value = 0;
+    for (i32 i = 0; i < 4; i++) {
+        value |= (u32)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+static u32 get_network_file_size(void)
+{
+    return 16 + NETWORK_FEATURES_NB * NETWORK_HIDDEN_NB + 2 * NETWORK_HIDDEN_NB + NETWORK_HIDDEN_NB + 8;
+}
+
+/**
+ * Load a network written by save_evaluation_network(), the network is optional so this function returns NULL instead of stopping the game
+ * when the file cannot be read or was written for another network shape
+ */
+EvaluationNetwork *load_evaluation_network(const char *filepath)
+{
+    FILE *file = fopen(filepath, "rb");
+    if (file == NULL) {
+        trace_log(LOG_WARNING, "cannot open the evaluation network %s", filepath);
+        return NULL;
+    }
+
+    const u32 file_size = get_network_file_size();
+    u8 *bytes = (u8 *)malloc(file_size);
+    if (bytes == NULL) {
+        application_panic(__FILE__, __LINE__, "Memory allocation failed");
+    }
+    const size_t bytes_read = fread(bytes, 1, file_size, file);
+    const b32 has_trailing_bytes = (fgetc(file) != EOF);
+    fclose(file);
+
+    if (bytes_read != file_size || has_trailing_bytes || memcmp(bytes, NETWORK_FILE_MAGIC, 4) != 0 || read_u32(&bytes[4]) != NETWORK_FILE_VERSION
+        || read_u32(&bytes[8]) != NETWORK_FEATURES_NB || read_u32(&bytes[12]) != NETWORK_HIDDEN_NB) {
+        trace_log(LOG_WARNING, "%s is not an evaluation network of this version", filepath);
+        free(bytes);
+        return NULL;
+    }
+
+    EvaluationNetwork *network;
+    ALLOC_VAR(network, EvaluationNetwork);
+    const u8 *data = &bytes[16];
+    for (i32 feature = 0; feature < NETWORK_FEATURES_NB; feature++) {
+        for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+            network->feature_weights[feature][i] = (i8)*data++;
+        }
+    }
+    for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+        network->hidden_biases[i] = (i16)(data[0] | (data[1] << 8));
+        data += 2;
+    }
+    for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+        network->output_weights[i] = (i8)*data++;
+    }
+    network->output_bias = (i32)read_u32(data);
+    network->output_shift = (i32)read_u32(data + 4);
+    free(bytes);
+
+    // The hidden layer sums 19 weight rows in 16 bits, the biases must leave room for them
+    b32 is_valid = network->output_shift >= 0 && network->output_shift <= NETWORK_MAX_OUTPUT_SHIFT;
+    for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+        is_valid = is_valid && network->hidden_biases[i] >= -16384 && network->hidden_biases[i] <= 16384;
+    }
+    if (!is_valid) {
+        trace_log(LOG_WARNING, "%s has out of range parameters", filepath);
+        free(network);
+        return NULL;
+    }
+
+    trace_log(LOG_INFO, "evaluation network %s loaded", filepath);
+    return network;
+}
+
+/**
+ * Write `network` to `filepath`, this function returns false if the file cannot be written
+ */
+b32 save_evaluation_network(const EvaluationNetwork *network, const char *filepath)
+{
+    const u32 file_size = get_network_file_size();
+    u8 *bytes = (u8 *)malloc(file_size);
+    if (bytes == NULL) {
+        application_panic(__FILE__, __LINE__, "Memory allocation failed");
+    }
+
+    memcpy(bytes, NETWORK_FILE_MAGIC, 4);
+    write_u32(&bytes[4], NETWORK_FILE_VERSION);
+    write_u32(&bytes[8], NETWORK_FEATURES_NB);
+    write_u32(&bytes[12], NETWORK_HIDDEN_NB);
+    u8 *data = &bytes[16];
+    for (i32 feature = 0; feature < NETWORK_FEATURES_NB; feature++) {
+        for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+            *data++ = (u8)network->feature_weights[feature][i];
+        }
+    }
+    for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+        *data++ = (u8)network->hidden_biases[i];
+        *data++ = (u8)((u16)network->hidden_biases[i] >> 8);
+    }
+    for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+        *data++ = (u8)network->output_weights[i];
+    }
+    write_u32(data, (u32)network->output_bias);
+    write_u32(data + 4, (u32)network->output_shift);
+
+    FILE *file = fopen(filepath, "wb");
+    b32 is_written = false;
+    if (file != NULL) {
+        is_written = (fwrite(bytes, 1, file_size, file) == file_size);
+        is_written = (fclose(file) == 0) && is_written;
+    }
+    free(bytes);
+    if (!is_written) {
+        trace_log(LOG_WARNING, "cannot write the evaluation network %s", filepath);
+    }
+    return is_written;
+}
+
+void destroy_evaluation_network(EvaluationNetwork *network)
+{
+    free(network);
+}
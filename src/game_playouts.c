@@ -0,0 +1,200 @@
+#include <string.h>
+
+#include "game_botbrain.h"
+
+/**
+ * Lanes of the batched playouts, one game per lane
+ * The vector extensions of the compiler map them to the registers of the target, or to scalar code when it has none
+ * Each batch uses vectors of one register: wider ones no longer fit the 12 masks of the games in the registers
+ */
+typedef u16 PlayoutMasks8 __attribute__((vector_size(8 * sizeof(u16))));
+typedef u32 PlayoutRandomState8 __attribute__((vector_size(8 * sizeof(u16)))); // one generator for two lanes
+typedef u16 PlayoutMasks16 __attribute__((vector_size(16 * sizeof(u16))));
+typedef u32 PlayoutRandomState16 __attribute__((vector_size(16 * sizeof(u16))));
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(PLATFORM_WEB)
+#define HAS_AVX2_PLAYOUTS
+#endif
+
+// xorshift64*
+u32 playout_random(u64 *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return (u32)((*state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/**
+ * Play random moves from `pos` until the end of the game
+ * This function returns the side of the winner, or PLAYOUT_DRAW
+ */
+i32 random_playout(Position *pos, u64 *random_state)
+{
+    u16 moves = position_legal_moves(pos);
+    while (true) {
+        const i32 mover = pos->side_to_move;
+        u16 picked = moves;
+        for (i32 skip = playout_random(random_state) % count_bits(moves); skip > 0; skip--) {
+            picked &= picked - 1;
+        }
+        const i32 cell = __builtin_ctz(picked);
+        position_make_move(pos, cell);
+
+        const PositionOutcome outcome = position_outcome(pos, cell, &moves);
+        if (outcome == POSITION_DRAW) {
+            return PLAYOUT_DRAW;
+        }
+        if (outcome == POSITION_LOST) {
+            return mover;
+        }
+    }
+}
+
+/**
+ * Define run_playout_batch_`suffix`(), with `lanes` games per batch and compiled with `attributes`
+ * The helpers take the vectors by address: passing vectors by value depends on the vector ABI of the target
+ */
+#define DEFINE_PLAYOUT_BATCH(suffix, lanes, attributes)                                                                                               \
+    static inline __attribute__((always_inline)) attributes b32 is_any_lane_set_##suffix(const PlayoutMasks##lanes *masks)                         \
+    {                                                                                                                                                 \
+        u64 words[sizeof(*masks) / sizeof(u64)];                                                                                                      \
+        memcpy(words, masks, sizeof(*masks));                                                                                                         \
+        u64 any = 0;                                                                                                                                  \
+        for (u32 i = 0; i < sizeof(*masks) / sizeof(u64); i++) {                                                                                      \
+            any |= words[i];                                                                                                                          \
+        }                                                                                                                                             \
+        return any != 0;                                                                                                                              \
+    }                                                                                                                                                 \
+                                                                                                                                                      \
+    /* The lanes of `flags` are either 0 or 0xFFFF */                                                                                                 \
+    static inline __attribute__((always_inline)) attributes u32 count_set_lanes_##suffix(const PlayoutMasks##lanes *flags)                         \
+    {                                                                                                                                                 \
+        u64 words[sizeof(*flags) / sizeof(u64)];                                                                                                      \
+        memcpy(words, flags, sizeof(*flags));                                                                                                         \
+        u32 bits = 0;                                                                                                                                 \
+        for (u32 i = 0; i < sizeof(*flags) / sizeof(u64); i++) {                                                                                      \
+            bits += __builtin_popcountll(words[i]);                                                                                                   \
+        }                                                                                                                                             \
+        return bits / 16;                                                                                                                             \
+    }                                                                                                                                                 \
+                                                                                                                                                      \
+    /* Pick a random cell of each mask, the lanes with an empty mask get an empty move                                                                \
+     * The rank of the cell is (random * count) >> 12 with 12 random bits, so that the product stays in 16 bits */                                    \
+    static inline __attribute__((always_inline)) attributes void pick_random_lane_cells_##suffix(const PlayoutMasks##lanes *moves,                 \
+                                                                                                 PlayoutRandomState##lanes *random_state,           \
+                                                                                                 PlayoutMasks##lanes *cells)                        \
+    {                                                                                                                                                 \
+        *random_state ^= *random_state << 13;                                                                                                         \
+        *random_state ^= *random_state >> 17;                                                                                                         \
+        *random_state ^= *random_state << 5;                                                                                                          \
+        const PlayoutMasks##lanes random = (PlayoutMasks##lanes)*random_state >> 4;                                                                   \
+                                                                                                                                                      \
+        PlayoutMasks##lanes bits = *moves - ((*moves >> 1) & 0x5555);                                                                                 \
+        bits = (bits & 0x3333) + ((bits >> 2) & 0x3333);                                                                                              \
+        bits = (bits + (bits >> 4)) & 0x0F0F;                                                                                                         \
+        const PlayoutMasks##lanes counts = (bits + (bits >> 8)) & 0x001F;                                                                             \
+        PlayoutMasks##lanes rank = (random * counts) >> 12;                                                                                           \
+        PlayoutMasks##lanes remaining = *moves;                                                                                                       \
+        while (is_any_lane_set_##suffix(&rank)) {                                                                                                     \
+            /* Drop the lowest cell of the lanes whose rank is not reached yet */                                                                     \
+            const PlayoutMasks##lanes skipping = (PlayoutMasks##lanes)(rank != 0);                                                                    \
+            remaining &= (remaining - 1) | ~skipping;                                                                                                 \
+            rank -= skipping & 1;                                                                                                                     \
+        }                                                                                                                                             \
+        *cells = remaining & -remaining;                                                                                                              \
+    }                                                                                                                                                 \
+                                                                                                                                                      \
+    static attributes void run_playout_batch_##suffix(const Position *pos, u64 *random_state, PlayoutResults *results)                              \
+    {                                                                                                                                                 \
+        PlayoutRandomState##lanes lane_random;                                                                                                        \
+        for (i32 i = 0; i < lanes / 2; i++) {                                                                                                         \
+            lane_random[i] = playout_random(random_state) | 1;                                                                                        \
+        }                                                                                                                                             \
+                                                                                                                                                      \
+        const PlayoutMasks##lanes zero = {0};                                                                                                         \
+        PlayoutMasks##lanes tokens[2] = {zero + pos->tokens[0], zero + pos->tokens[1]};                                                               \
+        PlayoutMasks##lanes colors[CARD_COLORS_NB];                                                                                                   \
+        for (i32 color = 0; color < CARD_COLORS_NB; color++) {                                                                                        \
+            colors[color] = zero + pos->colors[color];                                                                                                \
+        }                                                                                                                                             \
+        PlayoutMasks##lanes moves = zero + position_legal_moves(pos);                                                                                 \
+        PlayoutMasks##lanes playing = zero + 0xFFFF;                                                                                                  \
+        i32 mover = pos->side_to_move;                                                                                                                \
+                                                                                                                                                      \
+        while (is_any_lane_set_##suffix(&playing)) {                                                                                                  \
+            PlayoutMasks##lanes cell;                                                                                                                 \
+            pick_random_lane_cells_##suffix(&moves, &lane_random, &cell);                                                                             \
+                                                                                                                                                      \
+            /* The colors of the taken card give the moves of the next player */                                                                      \
+            PlayoutMasks##lanes next_moves = zero;                                                                                                    \
+            for (i32 color = 0; color < CARD_COLORS_NB; color++) {                                                                                    \
+                const PlayoutMasks##lanes has_color = (PlayoutMasks##lanes)((colors[color] & cell) != 0);                                             \
+                colors[color] &= ~cell;                                                                                                               \
+                next_moves |= colors[color] & has_color;                                                                                              \
+            }                                                                                                                                         \
+            tokens[mover] |= cell;                                                                                                                    \
+                                                                                                                                                      \
+            /* position_outcome() in each lane */                                                                                                     \
+            const PlayoutMasks##lanes full = (PlayoutMasks##lanes)((tokens[0] | tokens[1]) == 0xFFFF);                                                \
+            PlayoutMasks##lanes won = (PlayoutMasks##lanes)(next_moves == 0);                                                                         \
+            for (i32 i = 0; i < WIN_PATTERNS_NB; i++) {                                                                                               \
+                won |= (PlayoutMasks##lanes)((tokens[mover] & win_patterns[i]) == win_patterns[i]);                                                   \
+            }                                                                                                                                         \
+                                                                                                                                                      \
+            const PlayoutMasks##lanes drawn_lanes = playing & full;                                                                                   \
+            const PlayoutMasks##lanes won_lanes = playing & won & ~full;                                                                              \
+            results->draws += count_set_lanes_##suffix(&drawn_lanes);                                                                                 \
+            results->wins[mover] += count_set_lanes_##suffix(&won_lanes);                                                                             \
+            playing &= ~(full | won);                                                                                                                 \
+            moves = next_moves & playing;                                                                                                             \
+            mover ^= 1;                                                                                                                               \
+        }                                                                                                                                             \
+    }
+
+// SSE2, NEON and wasm simd128 registers, or scalar code on the targets without vectors
+DEFINE_PLAYOUT_BATCH(vector, 8, )
+
+#ifdef HAS_AVX2_PLAYOUTS
+DEFINE_PLAYOUT_BATCH(avx2, 16, __attribute__((target("avx2"))))
+#endif
+
+// Games per batch of run_playout_batch(), 0 until the first batch picks the widest registers of the processor
+static atomic_uint playout_batch_size = 0;
+
+/**
+ * Return the number of games that run_playout_batch() plays at once: 16 on the x86 processors with AVX2, 8 otherwise
+ */
+u32 get_playout_batch_size(void)
+{
+    u32 batch_size = atomic_load_explicit(&playout_batch_size, memory_order_relaxed);
+    if (batch_size != 0) {
+        return batch_size;
+    }
+
+    batch_size = 8;
+#ifdef HAS_AVX2_PLAYOUTS
+    if (__builtin_cpu_supports("avx2")) {
+        batch_size = 16;
+    }
+#endif
+    atomic_store_explicit(&playout_batch_size, batch_size, memory_order_relaxed);
+    return batch_size;
+}
+
+/**
+ * Play get_playout_batch_size() random games from `pos` at once, each lane is a game
+ * All the games start from the same position, so the side to move is the same in every lane and the moves only differ by their cell
+ * The lanes of the finished games get empty moves until the last game ends
+ * The results are added to `results`, `pos` must not be a finished game
+ */
+void run_playout_batch(const Position *pos, u64 *random_state, PlayoutResults *results)
+{
+#ifdef HAS_AVX2_PLAYOUTS
+    if (get_playout_batch_size() == 16) {
+        run_playout_batch_avx2(pos, random_state, results);
+        return;
+    }
+#endif
+    run_playout_batch_vector(pos, random_state, results);
+}
@@ -152,81 +152,14 @@ static void draw_pressed_tile(TileType tile_type, Vec2f pos, i32 size, i32 defau
 /**
  * Draw board tiles
  */
-static b32 is_part_of_winning_combination(const Tile board[][BOARD_COLUMNS_NB], int row, int col)
-{
-    TileType type = board[row][col].type;
-
-    // Checking the line
-    b32 horizontal_win = true;
-    for (int j = 0; j < BOARD_COLUMNS_NB; j++) {
-        if (board[row][j].type != type) {
-            horizontal_win = false;
-            break;
-        }
-    }
-
-    // Checking the column
-    b32 vertical_win = true;
-    for (int i = 0; i < BOARD_ROWS_NB; i++) {
-        if (board[i][col].type != type) {
-            vertical_win = false;
-            break;
-        }
-    }
-
-    // Checking 2x2 squares, if applicable
-    b32 square_win = false;
-    for (int dr = 0; dr <= 1; dr++) {
-        for (int dc = 0; dc <= 1; dc++) {
-            int square_row = row - dr;
-            int square_col = col - dc;
-            // Check that indices are valid for a 2x2 square
-            if (square_row >= 0 && square_row < BOARD_ROWS_NB - 1 && square_col >= 0 && square_col < BOARD_COLUMNS_NB - 1) {
-                square_win = (board[square_row][square_col].type == type &&
-                              board[square_row][square_col + 1].type == type &&
-                              board[square_row + 1][square_col].type == type &&
-                              board[square_row + 1][square_col + 1].type == type);
-                if (square_win) {
-                    break; // Early exit if a winning combination is found
-                }
-            }
-        }
-        if (square_win)
-            break;
-    }
-
-    // Checking diagonals, if applicable
-    b32 diagonal1_win = true, diagonal2_win = true;
-    if (row == col) { // Main diagonal
-        for (int i = 0; i < BOARD_ROWS_NB; i++) {
-            if (board[i][i].type != type) {
-                diagonal1_win = false;
-                break;
-            }
-        }
-    }
-    else {
-        diagonal1_win = false;
-    }
-
-    if (row == BOARD_ROWS_NB - 1 - col) { // Secondary diagonal
-        for (int i = 0; i < BOARD_ROWS_NB; i++) {
-            if (board[i][BOARD_ROWS_NB - 1 - i].type != type) {
-                diagonal2_win = false;
-                break;
-            }
-        }
-    }
-    else {
-        diagonal2_win = false;
-    }
-
-    return horizontal_win || vertical_win || square_win || diagonal1_win || diagonal2_win;
-}
-
 static void draw_board_tiles_end_game(const Tile board[][BOARD_COLUMNS_NB], const BoardGlobalRenderingData *board_rendering_data)
 {
     const Vec2f first_card_pos = {board_rendering_data->pos.x + board_rendering_data->padding, board_rendering_data->pos.y + board_rendering_data->padding};
+
+    // Tiles belonging to a winning combination are not darkened
+    const Position board_pos = position_from_board(board, EMPTY_TILE, PLAYER1);
+    const u16 highlighted_cells = winning_cells(board_pos.tokens[0]) | winning_cells(board_pos.tokens[1]);
+
     for (i32 i = 0; i < 4; i++) {
         for (i32 j = 0; j < 4; j++) {
             Vec2f pos = {
@@ -234,7 +167,7 @@ static void draw_board_tiles_end_game(const Tile board[][BOARD_COLUMNS_NB], cons
                 pos.y = first_card_pos.y + j * (board_rendering_data->tile_size + board_rendering_data->tile_spacing)};
 
             b32 is_darken = true;
-            if (is_part_of_winning_combination(board, i, j)) {
+            if (highlighted_cells & CELL_BIT(CELL_INDEX(i, j))) {
                 is_darken = false;
             }
 
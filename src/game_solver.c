@@ -0,0 +1,48 @@
+#include "game_botbrain.h"
+
+/**
+ * Solve a whole game from its deal: the exact value of the game for the first player and of each of its first moves
+ * Every first move is solved completely, so that the other optimal first moves are known too
+ */
+DealSolution solve_deal(const Tile board[][BOARD_COLUMNS_NB])
+{
+    const f64 start_time = get_precise_time();
+
+    DealSolution solution = {0};
+    solution.outcome = OUTCOME_LOSS;
+    solution.best_cell = NO_MOVE;
+
+    Position pos = position_from_board(board, EMPTY_TILE, PLAYER1);
+    const u16 moves = position_legal_moves(&pos);
+    for (i32 cell = 0; cell < BOARD_CELLS_NB; cell++) {
+        solution.moves[cell].outcome = OUTCOME_LOSS;
+        solution.moves[cell].distance = -1;
+    }
+
+    for (u16 remaining = moves; remaining != 0; remaining &= remaining - 1) {
+        const i32 cell = __builtin_ctz(remaining);
+        const TileType previous_last_card = position_make_move(&pos, cell);
+
+        // A single token cannot end the game, the reply of the second player is solved
+        const EndgameResult reply = solve_endgame(&pos, INFINITY, 0, NULL);
+        position_unmake_move(&pos, cell, previous_last_card);
+        ASSERT(reply.is_complete, "The solver has no deadline");
+
+        DealMoveValue *value = &solution.moves[cell];
+        value->outcome = (GameOutcome)(-reply.outcome);
+        value->distance = reply.distance + 1;
+        solution.nodes += reply.nodes;
+
+        // Prefer the best outcome, then the quickest win or the slowest loss
+        const DealMoveValue *best = (solution.best_cell == NO_MOVE) ? NULL : &solution.moves[solution.best_cell];
+        if (best == NULL || value->outcome > best->outcome || (value->outcome == best->outcome && value->outcome == OUTCOME_WIN && value->distance < best->distance) || (value->outcome == best->outcome && value->outcome == OUTCOME_LOSS && value->distance > best->distance)) {
+            solution.best_cell = cell;
+        }
+    }
+
+    ASSERT(solution.best_cell != NO_MOVE, "The first player always has a move");
+    solution.outcome = solution.moves[solution.best_cell].outcome;
+    solution.distance = solution.moves[solution.best_cell].distance;
+    solution.time = get_precise_time() - start_time;
+    return solution;
+}
@@ -0,0 +1,160 @@
+#include "game.h"
+
+/**
+ * Cell permutations of the 8 symmetries of the square: identity, rotations by 90, 180 and 270 degrees, and the 4 reflections
+ * symmetry_cells[s][cell] is the cell where `cell` goes. The win patterns and the central cells are invariant under all of them
+ */
+const u8 symmetry_cells[SYMMETRIES_NB][BOARD_CELLS_NB] = {
+    { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+    { 3,  7, 11, 15,  2,  6, 10, 14,  1,  5,  9, 13,  0,  4,  8, 12},
+    {15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0},
+    {12,  8,  4,  0, 13,  9,  5,  1, 14, 10,  6,  2, 15, 11,  7,  3},
+    {12, 13, 14, 15,  8,  9, 10, 11,  4,  5,  6,  7,  0,  1,  2,  3},
+    { 3,  2,  1,  0,  7,  6,  5,  4, 11, 10,  9,  8, 15, 14, 13, 12},
+    { 0,  4,  8, 12,  1,  5,  9, 13,  2,  6, 10, 14,  3,  7, 11, 15},
+    {15, 11,  7,  3, 14, 10,  6,  2, 13,  9,  5,  1, 12,  8,  4,  0},
+};
+
+// symmetry_inverse[s] undoes symmetry s
+const u8 symmetry_inverse[SYMMETRIES_NB] = {0, 3, 2, 1, 4, 5, 6, 7};
+
+static u16 transform_mask(const u16 mask, const i32 symmetry)
+{
+    u16 result = 0;
+    for (u16 remaining = mask; remaining != 0; remaining &= remaining - 1) {
+        result |= CELL_BIT(symmetry_cells[symmetry][__builtin_ctz(remaining)]);
+    }
+    return result;
+}
+
+/**
+ * Apply a symmetry of the board and a relabeling of the colors to a position
+ * `first_colors[i]` is the new index of the first color i (0-3), `second_colors[i]` the new index of the second color 4 + i (0-3)
+ * The color compatibility rule only compares first colors with first colors and second colors with second colors, so it is preserved
+ */
+Position position_transform(const Position *pos, const i32 symmetry, const u8 first_colors[4], const u8 second_colors[4])
+{
+    Position result = {0};
+    result.side_to_move = pos->side_to_move;
+    result.tokens[0] = transform_mask(pos->tokens[0], symmetry);
+    result.tokens[1] = transform_mask(pos->tokens[1], symmetry);
+    for (i32 i = 0; i < 4; i++) {
+        result.colors[first_colors[i]] = transform_mask(pos->colors[i], symmetry);
+        result.colors[4 + second_colors[i]] = transform_mask(pos->colors[4 + i], symmetry);
+    }
+
+    result.last_card = pos->last_card;
+    if (pos->last_card < CARD_TYPES_NB) {
+        result.last_card = first_colors[CARD_FIRST_COLOR(pos->last_card)] * 4 + second_colors[CARD_SECOND_COLOR(pos->last_card) - 4];
+    }
+
+    result.key = position_compute_key(&result);
+    return result;
+}
+
+/**
+ * Number the 4 colors of a family (first or second colors) by their first appearance on the board
+ * The color of the last discarded card comes before the other colors that are not on the board anymore, those are interchangeable
+ */
+static void get_colors_order(const u16 masks[4], const i32 last_color, u8 order[4])
+{
+    i32 ranks[4];
+    for (i32 i = 0; i < 4; i++) {
+        if (masks[i] != 0) {
+            ranks[i] = __builtin_ctz(masks[i]);
+        }
+        else {
+            ranks[i] = (i == last_color) ? BOARD_CELLS_NB : BOARD_CELLS_NB + 1;
+        }
+    }
+
+    for (i32 i = 0; i < 4; i++) {
+        order[i] = 0;
+        for (i32 j = 0; j < 4; j++) {
+            if (ranks[j] < ranks[i] || (ranks[j] == ranks[i] && j < i)) {
+                order[i]++;
+            }
+        }
+    }
+}
+
+static i32 compare_positions(const Position *a, const Position *b)
+{
+    if (a->tokens[0] != b->tokens[0]) {
+        return (a->tokens[0] < b->tokens[0]) ? -1 : 1;
+    }
+    if (a->tokens[1] != b->tokens[1]) {
+        return (a->tokens[1] < b->tokens[1]) ? -1 : 1;
+    }
+    for (i32 i = 0; i < CARD_COLORS_NB; i++) {
+        if (a->colors[i] != b->colors[i]) {
+            return (a->colors[i] < b->colors[i]) ? -1 : 1;
+        }
+    }
+    return (i32)a->last_card - (i32)b->last_card;
+}
+
+/**
+ * Map a position to the representative of its class: the 8 symmetries of the board combined with the relabelings of the colors give the same game
+ * For each symmetry the colors are numbered by first appearance, and the smallest resulting position is the representative
+ * `symmetry` receives the symmetry that maps the cells of `pos` to the cells of the representative
+ */
+Position position_canonical(const Position *pos, i32 *symmetry)
+{
+    const i32 last_first_color = (pos->last_card < CARD_TYPES_NB) ? CARD_FIRST_COLOR(pos->last_card) : -1;
+    const i32 last_second_color = (pos->last_card < CARD_TYPES_NB) ? CARD_SECOND_COLOR(pos->last_card) - 4 : -1;
+
+    Position best = {0};
+    i32 best_symmetry = -1;
+    for (i32 s = 0; s < SYMMETRIES_NB; s++) {
+        u16 first_masks[4];
+        u16 second_masks[4];
+        for (i32 i = 0; i < 4; i++) {
+            first_masks[i] = transform_mask(pos->colors[i], s);
+            second_masks[i] = transform_mask(pos->colors[4 + i], s);
+        }
+
+        u8 first_order[4];
+        u8 second_order[4];
+        get_colors_order(first_masks, last_first_color, first_order);
+        get_colors_order(second_masks, last_second_color, second_order);
+
+        const Position candidate = position_transform(pos, s, first_order, second_order);
+        if (best_symmetry < 0 || compare_positions(&candidate, &best) < 0) {
+            best = candidate;
+            best_symmetry = s;
+        }
+    }
+
+    if (symmetry != NULL) {
+        *symmetry = best_symmetry;
+    }
+    return best;
+}
+
+static u64 mix_bits(u64 x)
+{
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * Key of the representative of a position
+ * Unlike the zobrist key, it covers the cards: two positions of different deals only share it if they are equivalent
+ */
+u64 position_canonical_key(const Position *pos, i32 *symmetry)
+{
+    const Position canonical = position_canonical(pos, symmetry);
+    u64 first_colors = 0;
+    u64 second_colors = 0;
+    for (i32 i = 0; i < 4; i++) {
+        first_colors |= (u64)canonical.colors[i] << (16 * i);
+        second_colors |= (u64)canonical.colors[4 + i] << (16 * i);
+    }
+    return canonical.key ^ mix_bits(first_colors) ^ mix_bits(second_colors ^ 0x9E3779B97F4A7C15ULL);
+}
@@ -0,0 +1,137 @@
+#include "game_botbrain.h"
+
+// Layout of TTSlot.data
+#define TT_SCORE_SHIFT 0
+#define TT_DEPTH_SHIFT 16
+#define TT_BOUND_SHIFT 24
+#define TT_MOVE_SHIFT 32
+#define TT_GENERATION_SHIFT 40
+
+static u64 pack_entry(const i32 depth, const BoundType bound, const i32 score, const i32 best_move, const u8 generation)
+{
+    return ((u64)(u16)(i16)score << TT_SCORE_SHIFT) | ((u64)(u8)depth << TT_DEPTH_SHIFT) | ((u64)(u8)bound << TT_BOUND_SHIFT) | ((u64)(u8)best_move << TT_MOVE_SHIFT) | ((u64)generation << TT_GENERATION_SHIFT);
+}
+
+static TTEntry unpack_entry(const u64 key, const u64 data)
+{
+    TTEntry entry;
+    entry.key = key;
+    entry.score = (i16)(u16)(data >> TT_SCORE_SHIFT);
+    entry.depth = (u8)(data >> TT_DEPTH_SHIFT);
+    entry.bound = (u8)(data >> TT_BOUND_SHIFT);
+    entry.best_move = (u8)(data >> TT_MOVE_SHIFT);
+    entry.generation = (u8)(data >> TT_GENERATION_SHIFT);
+    return entry;
+}
+
+void tt_init(TranspositionTable *tt, const i32 size_log2)
+{
+    ASSERT(size_log2 > 0 && size_log2 < 32, "Invalid transposition table size");
+
+    const u64 entries_nb = 1ULL << size_log2;
+    tt->slots = (TTSlot *)calloc(entries_nb, sizeof(TTSlot));
+    if (tt->slots == NULL) {
+        application_panic(__FILE__, __LINE__, "Memory allocation failed");
+    }
+    tt->mask = entries_nb - 1;
+    tt->is_owner = true;
+    tt->generation = 0;
+
+    tt->hits = 0;
+    tt->reused = 0;
+    tt->misses = 0;
+    tt->collisions = 0;
+    tt->stores = 0;
+}
+
+/**
+ * Make `view` use the entries of `owner`, with its own statistics
+ * Several threads can probe and store through their views at the same time
+ */
+void tt_share(TranspositionTable *view, const TranspositionTable *owner)
+{
+    view->slots = owner->slots;
+    view->mask = owner->mask;
+    view->is_owner = false;
+    view->generation = owner->generation;
+
+    view->hits = 0;
+    view->reused = 0;
+    view->misses = 0;
+    view->collisions = 0;
+    view->stores = 0;
+}
+
+void tt_free(TranspositionTable *tt)
+{
+    if (tt->is_owner) {
+        free(tt->slots);
+    }
+    tt->slots = NULL;
+    tt->mask = 0;
+}
+
+/**
+ * Start a new search on the table: the entries already stored become entries of earlier searches,
+ * they stay valid since the key covers the whole position. The statistics restart from zero
+ */
+void tt_new_search(TranspositionTable *tt)
+{
+    tt->generation++;
+
+    tt->hits = 0;
+    tt->reused = 0;
+    tt->misses = 0;
+    tt->collisions = 0;
+    tt->stores = 0;
+}
+
+/**
+ * Look for the position `key` in the table
+ * This function returns true and fills `entry` if the position has been stored
+ * The slot is read without lock: if another thread wrote it in between, the key check fails and the probe misses
+ */
+b32 tt_probe(TranspositionTable *tt, const u64 key, TTEntry *entry)
+{
+    TTSlot *slot = &tt->slots[key & tt->mask];
+    const u64 data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+    const u64 check = atomic_load_explicit(&slot->check, memory_order_relaxed);
+    const TTEntry slot_entry = unpack_entry(check ^ data, data);
+
+    if (slot_entry.bound != BOUND_NONE && slot_entry.key == key) {
+        tt->hits++;
+        if (slot_entry.generation != tt->generation) {
+            tt->reused++;
+        }
+        *entry = slot_entry;
+        return true;
+    }
+
+    tt->misses++;
+    if (slot_entry.bound != BOUND_NONE) {
+        tt->collisions++;
+    }
+    return false;
+}
+
+/**
+ * Store a search result, an entry of the same position stored by this search is only replaced by a search at least as deep
+ * Entries of earlier searches and of other positions are always replaced: the bounds of an earlier search
+ * were found with other windows from another root, a fresh result of the current search is worth more
+ */
+void tt_store(TranspositionTable *tt, const u64 key, const i32 depth, const BoundType bound, const i32 score, const i32 best_move)
+{
+    TTSlot *slot = &tt->slots[key & tt->mask];
+    const u64 old_data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+    const u64 old_check = atomic_load_explicit(&slot->check, memory_order_relaxed);
+    const TTEntry old_entry = unpack_entry(old_check ^ old_data, old_data);
+
+    if (old_entry.bound != BOUND_NONE && old_entry.key == key && old_entry.generation == tt->generation && old_entry.depth > depth) {
+        return;
+    }
+
+    const u64 data = pack_entry(depth, bound, score, best_move, tt->generation);
+    atomic_store_explicit(&slot->check, key ^ data, memory_order_relaxed);
+    atomic_store_explicit(&slot->data, data, memory_order_relaxed);
+    tt->stores++;
+}
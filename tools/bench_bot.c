@@ -0,0 +1,924 @@
+/**
+ * Bot benchmark
+ * Searches a fixed set of seeded positions and prints node counts and times, so that search changes can be compared
+ *
+ * usage: bench_bot ordering|algorithms|sliced|endgame|symmetry|memory [positions_nb] [depth]
+ *        bench_bot evaluation [positions_nb] [rounds_nb]
+ *        bench_bot evaluation-batch [positions_nb] [copies_nb] [max_threads]
+ *        bench_bot network [positions_nb] [depth] [network_path]
+ *        bench_bot playouts [positions_nb] [playouts_nb]
+ *        bench_bot mcts|mcts-ponder [games_nb] [depth] [playout_budget]
+ *        bench_bot mcts-threads [positions_nb] [playout_budget] [max_threads]
+ *        bench_bot root-split|lazy-smp|work-stealing [positions_nb] [depth] [max_threads] [minimax|pvs]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "game_botbrain.h"
+
+#define BENCH_DEFAULT_POSITIONS_NB 24
+#define BENCH_DEFAULT_DEPTH 16
+#define BENCH_MAX_POSITIONS_NB 1024
+#define BENCH_DEFAULT_EVALUATION_ROUNDS 100000
+#define BENCH_DEFAULT_EVALUATION_COPIES 16384
+#define BENCH_DEFAULT_NETWORK_DEPTH 4
+#define BENCH_DEFAULT_NETWORK_PATH "./src/assets/evaluation_network.bin"
+#define BENCH_DEFAULT_PLAYOUTS_NB 100000
+#define BENCH_DEFAULT_PLAYOUT_BUDGET 20000
+#define BENCH_DEFAULT_MCTS_THREADS_PLAYOUTS 200000
+#define BENCH_PONDER_TIME 0.02 // seconds the human takes for each move in the pondering bench
+
+static u64 bench_random_state;
+
+// xorshift64*, so the positions do not depend on the libc rand()
+static u32 bench_random(void)
+{
+    bench_random_state ^= bench_random_state >> 12;
+    bench_random_state ^= bench_random_state << 25;
+    bench_random_state ^= bench_random_state >> 27;
+    return (u32)((bench_random_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+// Deal the cards of the next shuffle of bench_random()
+static void deal_bench_board(Tile board[][BOARD_COLUMNS_NB])
+{
+    TileType cards[BOARD_CELLS_NB];
+    for (i32 i = 0; i < BOARD_CELLS_NB; i++) {
+        cards[i] = (TileType)i;
+    }
+    for (i32 i = BOARD_CELLS_NB - 1; i > 0; i--) {
+        const i32 j = bench_random() % (i + 1);
+        const TileType temp = cards[i];
+        cards[i] = cards[j];
+        cards[j] = temp;
+    }
+    for (i32 i = 0; i < BOARD_CELLS_NB; i++) {
+        board[i / BOARD_COLUMNS_NB][i % BOARD_COLUMNS_NB].type = cards[i];
+        board[i / BOARD_COLUMNS_NB][i % BOARD_COLUMNS_NB].is_pressed = false;
+    }
+}
+
+/**
+ * Deal a shuffle from `seed` and play random legal moves until `plies` tokens are on the board
+ * The game must not be over, otherwise the position is dealt again
+ */
+static Position make_bench_position(const u32 seed, const i32 plies)
+{
+    bench_random_state = 0x9E3779B97F4A7C15ULL * (seed + 1);
+
+    while (true) {
+        Tile board[BOARD_ROWS_NB][BOARD_COLUMNS_NB];
+        deal_bench_board(board);
+
+        Position pos = position_from_board(board, EMPTY_TILE, PLAYER1);
+        b32 is_over = false;
+        for (i32 ply = 0; ply < plies && !is_over; ply++) {
+            u16 moves = position_legal_moves(&pos);
+            if (moves == 0) {
+                is_over = true;
+                break;
+            }
+            for (i32 skip = bench_random() % count_bits(moves); skip > 0; skip--) {
+                moves &= moves - 1;
+            }
+            const i32 cell = __builtin_ctz(moves);
+            position_make_move(&pos, cell);
+            is_over = is_winning_cell(pos.tokens[pos.side_to_move ^ 1], cell);
+        }
+
+        if (!is_over && position_legal_moves(&pos) != 0 && !position_is_full(&pos)) {
+            return pos;
+        }
+    }
+}
+
+// Positions from the bot first move to the middle game
+static Position get_bench_position(const i32 index)
+{
+    return make_bench_position(index, 1 + 2 * (index % 4));
+}
+
+// Positions with 10 to 7 uncovered cards
+static Position get_bench_endgame_position(const i32 index)
+{
+    return make_bench_position(index, 6 + (index % 4));
+}
+
+static void init_bench_settings(BotSettings *settings, const i32 depth)
+{
+    init_bot_settings(settings);
+    settings->time_budget = 1e9f;
+    settings->max_depth = depth;
+}
+
+/**
+ * Compare the node counts of the search with and without move ordering
+ * The endgame solver is disabled, its nodes would not depend on the ordering of the search
+ */
+static void bench_move_ordering(const i32 positions_nb, const i32 depth)
+{
+    BotSettings settings;
+    init_bench_settings(&settings, depth);
+    settings.endgame_threshold = 0;
+
+    u64 total_nodes[2] = {0, 0};
+    f64 total_time[2] = {0, 0};
+
+    printf("%8s %14s %10s %14s %10s\n", "position", "nodes", "time (s)", "nodes ordered", "time (s)");
+    for (i32 i = 0; i < positions_nb; i++) {
+        const Position pos = get_bench_position(i);
+        SearchStats stats[2];
+
+        for (i32 ordering = 0; ordering < 2; ordering++) {
+            settings.move_ordering = ordering;
+            search_best_move(&pos, &settings, NULL, &stats[ordering]);
+            total_nodes[ordering] += stats[ordering].nodes;
+            total_time[ordering] += stats[ordering].time;
+        }
+
+        if (stats[0].score != stats[1].score) {
+            printf("warning: position %d scores differ (%d / %d)\n", i, stats[0].score, stats[1].score);
+        }
+        printf("%8d %14llu %10.3f %14llu %10.3f\n", i, stats[0].nodes, stats[0].time, stats[1].nodes, stats[1].time);
+    }
+
+    printf("%8s %14llu %10.3f %14llu %10.3f\n", "total", total_nodes[0], total_time[0], total_nodes[1], total_time[1]);
+    printf("move ordering searches %.1f%% of the nodes\n", 100.0 * (f64)total_nodes[1] / (f64)total_nodes[0]);
+}
+
+/**
+ * Compare the node counts of minimax and of the principal variation search on the same positions
+ */
+static void bench_algorithms(const i32 positions_nb, const i32 depth)
+{
+    BotSettings settings;
+    init_bench_settings(&settings, depth);
+
+    u64 total_nodes[2] = {0, 0};
+    f64 total_time[2] = {0, 0};
+
+    printf("%8s %14s %10s %14s %10s %8s\n", "position", "nodes minimax", "time (s)", "nodes pvs", "time (s)", "score");
+    for (i32 i = 0; i < positions_nb; i++) {
+        const Position pos = get_bench_position(i);
+        SearchStats stats[2];
+
+        settings.algorithm = BOT_ALGORITHM_MINIMAX;
+        search_best_move(&pos, &settings, NULL, &stats[0]);
+        settings.algorithm = BOT_ALGORITHM_PVS;
+        search_best_move(&pos, &settings, NULL, &stats[1]);
+
+        for (i32 algorithm = 0; algorithm < 2; algorithm++) {
+            total_nodes[algorithm] += stats[algorithm].nodes;
+            total_time[algorithm] += stats[algorithm].time;
+        }
+
+        if (stats[0].score != stats[1].score) {
+            printf("warning: position %d scores differ (%d / %d)\n", i, stats[0].score, stats[1].score);
+        }
+        printf("%8d %14llu %10.3f %14llu %10.3f %8d\n", i, stats[0].nodes, stats[0].time, stats[1].nodes, stats[1].time, stats[1].score);
+    }
+
+    printf("%8s %14llu %10.3f %14llu %10.3f\n", "total", total_nodes[0], total_time[0], total_nodes[1], total_time[1]);
+    printf("pvs searches %.1f%% of the minimax nodes\n", 100.0 * (f64)total_nodes[1] / (f64)total_nodes[0]);
+}
+
+/**
+ * Search the same positions with minimax() and with the sliced search, on one thread and without the endgame solver
+ * Both searches walk the same tree, so any difference in move, score, depth or nodes means they have diverged
+ */
+static void bench_sliced(const i32 positions_nb, const i32 depth)
+{
+    BotSettings settings;
+    init_bench_settings(&settings, depth);
+    settings.threads = 1;
+    settings.endgame_threshold = 0;
+
+    u64 total_nodes[2] = {0, 0};
+    f64 total_time[2] = {0, 0};
+    i32 mismatches_nb = 0;
+
+    printf("%8s %14s %10s %14s %10s %8s\n", "position", "nodes minimax", "time (s)", "nodes sliced", "time (s)", "score");
+    for (i32 i = 0; i < positions_nb; i++) {
+        const Position pos = get_bench_position(i);
+        SearchStats stats;
+        search_best_move(&pos, &settings, NULL, &stats);
+
+        SlicedSearch *search;
+        ALLOC_VAR(search, SlicedSearch);
+        const f64 start_time = get_precise_time();
+        start_sliced_search(search, &pos, &settings, NULL);
+        while (!run_sliced_search(search, settings.slice_time)) {
+        }
+        const f64 sliced_time = get_precise_time() - start_time;
+
+        total_nodes[0] += stats.nodes;
+        total_nodes[1] += search->ctx.nodes;
+        total_time[0] += stats.time;
+        total_time[1] += sliced_time;
+
+        if (stats.best_cell != search->best_cell || stats.score != search->completed_score || stats.depth != search->completed_depth
+            || stats.nodes != search->ctx.nodes) {
+            printf("warning: position %d differs (move %d / %d, score %d / %d, depth %d / %d)\n", i, stats.best_cell, search->best_cell, stats.score,
+                   search->completed_score, stats.depth, search->completed_depth);
+            mismatches_nb++;
+        }
+        printf("%8d %14llu %10.3f %14llu %10.3f %8d\n", i, stats.nodes, stats.time, search->ctx.nodes, sliced_time, search->completed_score);
+
+        free_sliced_search(search);
+        free(search);
+    }
+
+    printf("%8s %14llu %10.3f %14llu %10.3f\n", "total", total_nodes[0], total_time[0], total_nodes[1], total_time[1]);
+    printf("%d positions out of %d differ\n", mismatches_nb, positions_nb);
+}
+
+/**
+ * Compare the depth-limited search and the endgame solver on late positions
+ */
+static void bench_endgame(const i32 positions_nb, const i32 depth)
+{
+    BotSettings settings;
+    init_bench_settings(&settings, depth);
+
+    u64 total_nodes[2] = {0, 0};
+    f64 total_time[2] = {0, 0};
+
+    printf("%8s %8s %14s %10s %14s %10s %8s\n", "position", "cards", "nodes search", "time (s)", "nodes solver", "time (s)", "score");
+    for (i32 i = 0; i < positions_nb; i++) {
+        const Position pos = get_bench_endgame_position(i);
+        SearchStats stats[2];
+
+        settings.endgame_threshold = 0;
+        search_best_move(&pos, &settings, NULL, &stats[0]);
+        settings.endgame_threshold = BOARD_CELLS_NB;
+        search_best_move(&pos, &settings, NULL, &stats[1]);
+
+        for (i32 solver = 0; solver < 2; solver++) {
+            total_nodes[solver] += stats[solver].nodes;
+            total_time[solver] += stats[solver].time;
+        }
+
+        if (stats[0].score != stats[1].score) {
+            printf("warning: position %d scores differ (%d / %d)\n", i, stats[0].score, stats[1].score);
+        }
+        const i32 uncovered = BOARD_CELLS_NB - count_bits(pos.tokens[0] | pos.tokens[1]);
+        printf("%8d %8d %14llu %10.4f %14llu %10.4f %8d\n", i, uncovered, stats[0].nodes, stats[0].time, stats[1].nodes, stats[1].time, stats[1].score);
+    }
+
+    printf("%8s %8s %14llu %10.4f %14llu %10.4f\n", "total", "", total_nodes[0], total_time[0], total_nodes[1], total_time[1]);
+    printf("the solver searches %.1f%% of the nodes in %.1f%% of the time\n", 100.0 * (f64)total_nodes[1] / (f64)total_nodes[0], 100.0 * total_time[1] / total_time[0]);
+}
+
+/**
+ * Compare the transposition table keyed by position and keyed by canonical position
+ * The endgame solver is disabled, so that every node goes through the table
+ */
+static void bench_symmetry(const i32 positions_nb, const i32 depth)
+{
+    BotSettings settings;
+    init_bench_settings(&settings, depth);
+    settings.endgame_threshold = 0;
+
+    u64 total_nodes[2] = {0, 0};
+    u64 total_hits[2] = {0, 0};
+    u64 total_probes[2] = {0, 0};
+    f64 total_time[2] = {0, 0};
+
+    printf("%8s %14s %8s %10s %14s %8s %10s\n", "position", "nodes", "hits", "time (s)", "nodes canon", "hits", "time (s)");
+    for (i32 i = 0; i < positions_nb; i++) {
+        const Position pos = get_bench_position(i);
+        SearchStats stats[2];
+
+        for (i32 canonical = 0; canonical < 2; canonical++) {
+            settings.canonical_tt = canonical;
+            search_best_move(&pos, &settings, NULL, &stats[canonical]);
+            total_nodes[canonical] += stats[canonical].nodes;
+            total_hits[canonical] += stats[canonical].tt_hits;
+            total_probes[canonical] += stats[canonical].tt_hits + stats[canonical].tt_misses;
+            total_time[canonical] += stats[canonical].time;
+        }
+
+        if (stats[0].score != stats[1].score) {
+            printf("warning: position %d scores differ (%d / %d)\n", i, stats[0].score, stats[1].score);
+        }
+        printf("%8d %14llu %7.1f%% %10.3f %14llu %7.1f%% %10.3f\n", i, stats[0].nodes, 100.0 * stats[0].tt_hits / (f64)(stats[0].tt_hits + stats[0].tt_misses), stats[0].time, stats[1].nodes, 100.0 * stats[1].tt_hits / (f64)(stats[1].tt_hits + stats[1].tt_misses), stats[1].time);
+    }
+
+    printf("%8s %14llu %7.1f%% %10.3f %14llu %7.1f%% %10.3f\n", "total", total_nodes[0], 100.0 * total_hits[0] / (f64)total_probes[0], total_time[0], total_nodes[1], 100.0 * total_hits[1] / (f64)total_probes[1], total_time[1]);
+    printf("the canonical table searches %.1f%% of the nodes\n", 100.0 * (f64)total_nodes[1] / (f64)total_nodes[0]);
+}
+
+/**
+ * Play whole games where each side keeps its search memory between its moves, and search every move cold too
+ * The table gives, for each ply of the game, the nodes of both searches and the share of the table hits that come from earlier searches
+ * The endgame solver is disabled, so that every move goes through the search
+ */
+static void bench_memory(const i32 games_nb, const i32 depth)
+{
+    BotSettings settings;
+    init_bench_settings(&settings, depth);
+    settings.endgame_threshold = 0;
+
+    i32 moves_nb[BOARD_CELLS_NB] = {0};
+    u64 cold_nodes[BOARD_CELLS_NB] = {0};
+    u64 warm_nodes[BOARD_CELLS_NB] = {0};
+    u64 tt_hits[BOARD_CELLS_NB] = {0};
+    u64 tt_reused[BOARD_CELLS_NB] = {0};
+    f64 total_time[2] = {0, 0};
+
+    for (i32 game = 0; game < games_nb; game++) {
+        Position pos = make_bench_position(game, 0);
+        SearchMemory *memories[2] = {create_search_memory(&settings), create_search_memory(&settings)};
+
+        for (i32 ply = 0; ply < BOARD_CELLS_NB && position_legal_moves(&pos) != 0; ply++) {
+            SearchStats stats[2];
+            search_best_move(&pos, &settings, NULL, &stats[0]);
+            const i32 cell = search_best_move_with_memory(&pos, &settings, memories[pos.side_to_move], NULL, &stats[1]);
+            if (stats[0].score != stats[1].score) {
+                printf("warning: game %d ply %d scores differ (%d / %d)\n", game, ply, stats[0].score, stats[1].score);
+            }
+
+            moves_nb[ply]++;
+            cold_nodes[ply] += stats[0].nodes;
+            warm_nodes[ply] += stats[1].nodes;
+            tt_hits[ply] += stats[1].tt_hits;
+            tt_reused[ply] += stats[1].tt_reused;
+            total_time[0] += stats[0].time;
+            total_time[1] += stats[1].time;
+
+            position_make_move(&pos, cell);
+            if (is_winning_cell(pos.tokens[pos.side_to_move ^ 1], cell)) {
+                break;
+            }
+        }
+
+        destroy_search_memory(memories[0]);
+        destroy_search_memory(memories[1]);
+    }
+
+    u64 total_nodes[2] = {0, 0};
+    printf("%8s %8s %14s %14s %8s %8s\n", "ply", "moves", "nodes cold", "nodes memory", "ratio", "reused");
+    for (i32 ply = 0; ply < BOARD_CELLS_NB; ply++) {
+        if (moves_nb[ply] == 0) {
+            continue;
+        }
+        total_nodes[0] += cold_nodes[ply];
+        total_nodes[1] += warm_nodes[ply];
+        printf("%8d %8d %14llu %14llu %7.1f%% %7.1f%%\n", ply, moves_nb[ply], cold_nodes[ply], warm_nodes[ply], 100.0 * (f64)warm_nodes[ply] / (f64)cold_nodes[ply], (tt_hits[ply] != 0) ? 100.0 * (f64)tt_reused[ply] / (f64)tt_hits[ply] : 0.0);
+    }
+    printf("%8s %8s %14llu %14llu %7.1f%%\n", "total", "", total_nodes[0], total_nodes[1], 100.0 * (f64)total_nodes[1] / (f64)total_nodes[0]);
+    printf("the search memory searches %.1f%% of the nodes in %.1f%% of the time\n", 100.0 * (f64)total_nodes[1] / (f64)total_nodes[0], 100.0 * total_time[1] / total_time[0]);
+}
+
+/**
+ * Evaluate the positions `rounds_nb` times with the pattern ladder of evaluate_board() and with each evaluation kernel the processor supports
+ * All the evaluations must give the same scores, the table shows their throughputs
+ */
+static void bench_evaluation(const i32 positions_nb, const i32 rounds_nb)
+{
+    Position positions[BENCH_MAX_POSITIONS_NB];
+    for (i32 i = 0; i < positions_nb; i++) {
+        positions[i] = make_bench_position(i, i % (BOARD_CELLS_NB - 4));
+    }
+
+    // The sums keep the evaluations from being optimized away
+    u64 ladder_sum = 0;
+    f64 start_time = get_precise_time();
+    for (i32 round = 0; round < rounds_nb; round++) {
+        for (i32 i = 0; i < positions_nb; i++) {
+            ladder_sum += (u64)(evaluate_board(&positions[i], 0) - evaluate_board(&positions[i], 1));
+        }
+    }
+    const f64 ladder_time = get_precise_time() - start_time;
+
+    const f64 evaluations_nb = (f64)positions_nb * rounds_nb;
+    const EvaluationKernel default_kernel = get_evaluation_kernel();
+    printf("%d positions, default kernel %s\n", positions_nb, get_evaluation_kernel_name(default_kernel));
+    printf("%16s %16s %12s %12s\n", "evaluation", "positions/s", "speedup", "mismatches");
+    printf("%16s %16.0f %12s %12s\n", "pattern ladder", evaluations_nb / ladder_time, "", "");
+
+    for (EvaluationKernel kernel = 0; kernel < EVALUATION_KERNELS_NB; kernel++) {
+        if (!set_evaluation_kernel(kernel)) {
+            printf("%16s %16s\n", get_evaluation_kernel_name(kernel), "unsupported");
+            continue;
+        }
+
+        i32 mismatches_nb = 0;
+        for (i32 i = 0; i < positions_nb; i++) {
+            if (evaluate_position(&positions[i]) != evaluate_board(&positions[i], 0) - evaluate_board(&positions[i], 1)) {
+                mismatches_nb++;
+            }
+        }
+
+        u64 sum = 0;
+        start_time = get_precise_time();
+        for (i32 round = 0; round < rounds_nb; round++) {
+            for (i32 i = 0; i < positions_nb; i++) {
+                sum += (u64)evaluate_position(&positions[i]);
+            }
+        }
+        const f64 time = get_precise_time() - start_time;
+        if (sum != ladder_sum) {
+            mismatches_nb++;
+        }
+        printf("%16s %16.0f %11.1fx %12d\n", get_evaluation_kernel_name(kernel), evaluations_nb / time, ladder_time / time, mismatches_nb);
+    }
+    set_evaluation_kernel(default_kernel);
+}
+
+/**
+ * Evaluate `copies_nb` copies of the positions one at a time, then with evaluate_positions() and 1 to `max_threads` threads
+ * The batches must give the same scores as evaluate_board(), the table shows their throughputs
+ */
+static void bench_evaluation_batch(const i32 positions_nb, const u32 copies_nb, const i32 max_threads)
+{
+    const u32 batch_size = (u32)positions_nb * copies_nb;
+    Position *positions = (Position *)malloc(batch_size * sizeof(Position));
+    i32 *expected_scores = (i32 *)malloc(batch_size * sizeof(i32));
+    i32 *scores = (i32 *)malloc(batch_size * sizeof(i32));
+    if (positions == NULL || expected_scores == NULL || scores == NULL) {
+        printf("cannot allocate %u positions\n", batch_size);
+        exit(1);
+    }
+    for (i32 i = 0; i < positions_nb; i++) {
+        const Position pos = make_bench_position(i, i % (BOARD_CELLS_NB - 4));
+        const i32 score = evaluate_board(&pos, 0) - evaluate_board(&pos, 1);
+        for (u32 copy = 0; copy < copies_nb; copy++) {
+            positions[copy * positions_nb + i] = pos;
+            expected_scores[copy * positions_nb + i] = score;
+        }
+    }
+
+    f64 start_time = get_precise_time();
+    for (u32 i = 0; i < batch_size; i++) {
+        scores[i] = evaluate_position(&positions[i]);
+    }
+    const f64 single_time = get_precise_time() - start_time;
+
+    printf("%u positions, kernel %s\n", batch_size, get_evaluation_kernel_name(get_evaluation_kernel()));
+    printf("%16s %16s %12s %12s\n", "threads", "positions/s", "speedup", "mismatches");
+    printf("%16s %16.0f %12s %12s\n", "one at a time", batch_size / single_time, "", "");
+    for (i32 threads = 1; threads <= max_threads; threads++) {
+        memset(scores, 0, batch_size * sizeof(i32));
+        start_time = get_precise_time();
+        evaluate_positions(positions, scores, batch_size, threads);
+        const f64 time = get_precise_time() - start_time;
+
+        i32 mismatches_nb = 0;
+        for (u32 i = 0; i < batch_size; i++) {
+            mismatches_nb += (scores[i] != expected_scores[i]);
+        }
+        printf("%16d %16.0f %11.1fx %12d\n", threads, batch_size / time, single_time / time, mismatches_nb);
+    }
+
+    free(positions);
+    free(expected_scores);
+    free(scores);
+}
+
+/**
+ * Exact outcome of playing `cell` in `pos` for the side to move
+ */
+static GameOutcome get_bench_move_outcome(const Position *pos, const i32 cell)
+{
+    Position child = *pos;
+    position_make_move(&child, cell);
+    if (position_is_full(&child)) {
+        return OUTCOME_DRAW;
+    }
+    if (is_winning_cell(child.tokens[pos->side_to_move], cell) || position_legal_moves(&child) == 0) {
+        return OUTCOME_WIN;
+    }
+    return (GameOutcome)(-solve_endgame(&child, INFINITY, 0, NULL).outcome);
+}
+
+/**
+ * Search the positions at `depth` without the endgame solver, scoring the leaves with the pattern table and then with the network at `network_path`
+ * The table shows the speed of each evaluation and the share of the moves that keep the exact value of the position
+ */
+static void bench_network(const i32 positions_nb, const i32 depth, const char *network_path)
+{
+    EvaluationNetwork *network = load_evaluation_network(network_path);
+    if (network == NULL) {
+        printf("cannot load the evaluation network %s\n", network_path);
+        exit(1);
+    }
+
+    BotSettings settings;
+    init_bench_settings(&settings, depth);
+    settings.endgame_threshold = 0;
+
+    u64 total_nodes[2] = {0, 0};
+    f64 total_time[2] = {0, 0};
+    i32 exact_moves_nb[2] = {0, 0};
+    for (i32 i = 0; i < positions_nb; i++) {
+        const Position pos = get_bench_position(i);
+        const GameOutcome best_outcome = solve_endgame(&pos, INFINITY, 0, NULL).outcome;
+
+        for (i32 evaluation = 0; evaluation < 2; evaluation++) {
+            settings.network = (evaluation == 0) ? NULL : network;
+            SearchStats stats;
+            search_best_move(&pos, &settings, NULL, &stats);
+            total_nodes[evaluation] += stats.nodes;
+            total_time[evaluation] += stats.time;
+            exact_moves_nb[evaluation] += (get_bench_move_outcome(&pos, stats.best_cell) == best_outcome);
+        }
+    }
+
+    const f64 pattern_rate = (f64)total_nodes[0] / total_time[0];
+    printf("%d positions, depth %d\n", positions_nb, depth);
+    printf("%16s %14s %10s %14s %10s %12s\n", "evaluation", "nodes", "time (s)", "nodes/s", "relative", "exact moves");
+    for (i32 evaluation = 0; evaluation < 2; evaluation++) {
+        const f64 rate = (f64)total_nodes[evaluation] / total_time[evaluation];
+        printf("%16s %14llu %10.3f %14.0f %9.2fx %11.1f%%\n", (evaluation == 0) ? "pattern table" : "network", total_nodes[evaluation], total_time[evaluation], rate, rate / pattern_rate, 100.0 * exact_moves_nb[evaluation] / positions_nb);
+    }
+    destroy_evaluation_network(network);
+}
+
+/**
+ * Run `playouts_nb` random playouts from each position, one at a time and in batches of get_playout_batch_size() games
+ * Both give the same statistics, the table shows the win rates of the player to move and the throughputs
+ */
+static void bench_playouts(const i32 positions_nb, const u32 playouts_nb)
+{
+    f64 total_time[2] = {0, 0};
+    u64 random_state = 0x9E3779B97F4A7C15ULL;
+    const u32 batch_size = get_playout_batch_size();
+    const u32 batches_nb = (playouts_nb + batch_size - 1) / batch_size;
+
+    printf("%u lanes per batch\n", batch_size);
+    printf("%8s %12s %12s %12s %12s\n", "position", "wins single", "wins batch", "draws single", "draws batch");
+    for (i32 i = 0; i < positions_nb; i++) {
+        const Position pos = get_bench_position(i);
+        PlayoutResults results[2] = {{{0, 0}, 0}, {{0, 0}, 0}};
+
+        f64 start_time = get_precise_time();
+        for (u32 playout = 0; playout < batches_nb * batch_size; playout++) {
+            Position playout_pos = pos;
+            const i32 winner = random_playout(&playout_pos, &random_state);
+            if (winner == PLAYOUT_DRAW) {
+                results[0].draws++;
+            }
+            else {
+                results[0].wins[winner]++;
+            }
+        }
+        total_time[0] += get_precise_time() - start_time;
+
+        start_time = get_precise_time();
+        for (u32 batch = 0; batch < batches_nb; batch++) {
+            run_playout_batch(&pos, &random_state, &results[1]);
+        }
+        total_time[1] += get_precise_time() - start_time;
+
+        const f64 games_nb = (f64)batches_nb * batch_size;
+        printf("%8d %11.2f%% %11.2f%% %11.2f%% %11.2f%%\n", i, 100.0 * results[0].wins[pos.side_to_move] / games_nb, 100.0 * results[1].wins[pos.side_to_move] / games_nb, 100.0 * results[0].draws / games_nb, 100.0 * results[1].draws / games_nb);
+    }
+
+    const f64 games_nb = (f64)positions_nb * batches_nb * batch_size;
+    printf("single: %.0f playouts/s, batch: %.0f playouts/s (%.2fx)\n", games_nb / total_time[0], games_nb / total_time[1], total_time[0] / total_time[1]);
+}
+
+/**
+ * Play games between the MCTS engine with `playout_budget` playouts per move and the minimax searching at `depth`
+ * Each deal is played twice, the engines exchanging their sides, and the endgame solver is disabled
+ * The MCTS keeps its tree between its moves, the share of the root visits that come from its earlier searches is printed too
+ */
+static void bench_mcts(const i32 games_nb, const i32 depth, const u64 playout_budget)
+{
+    BotSettings settings[2]; // minimax, mcts
+    init_bench_settings(&settings[0], depth);
+    settings[0].endgame_threshold = 0;
+    settings[1] = settings[0];
+    settings[1].engine = BOT_ENGINE_MCTS;
+    settings[1].playout_budget = playout_budget;
+
+    i32 results[3] = {0, 0, 0}; // mcts wins, draws, mcts losses
+    u64 playouts = 0;
+    f64 time[2] = {0, 0};
+    i32 moves_nb[2] = {0, 0};
+
+    u64 reused_visits = 0;
+
+    for (i32 game = 0; game < 2 * games_nb; game++) {
+        Position pos = make_bench_position(game / 2, 0);
+        const i32 mcts_side = game % 2;
+        SearchMemory *memory = create_search_memory(&settings[1]);
+
+        while (true) {
+            const i32 engine = (pos.side_to_move == mcts_side) ? 1 : 0;
+            SearchStats stats;
+            i32 cell;
+            if (engine == 1) {
+                cell = search_best_move_with_memory(&pos, &settings[1], memory, NULL, &stats);
+                playouts += stats.nodes;
+                reused_visits += stats.mcts_reused;
+            }
+            else {
+                cell = search_best_move(&pos, &settings[0], NULL, &stats);
+            }
+            time[engine] += stats.time;
+            moves_nb[engine]++;
+
+            const i32 mover = pos.side_to_move;
+            position_make_move(&pos, cell);
+            if (position_is_full(&pos)) {
+                results[1]++;
+                break;
+            }
+            if (is_winning_cell(pos.tokens[mover], cell) || position_legal_moves(&pos) == 0) {
+                results[(mover == mcts_side) ? 0 : 2]++;
+                break;
+            }
+        }
+        destroy_search_memory(memory);
+    }
+
+    printf("mcts (%llu playouts) against minimax (depth %d) over %d games: %d wins, %d draws, %d losses\n", playout_budget, depth, 2 * games_nb, results[0], results[1], results[2]);
+    printf("mcts: %.0f playouts/s, %.3f ms per move, %.1f%% of the root visits kept from the earlier moves\n", (f64)playouts / time[1], 1000.0 * time[1] / moves_nb[1], 100.0 * (f64)reused_visits / (f64)(reused_visits + playouts));
+    printf("minimax: %.3f ms per move\n", 1000.0 * time[0] / moves_nb[0]);
+}
+
+/**
+ * Play games between the MCTS bot and a minimax human searching at `depth`, through the pondering of the game:
+ * during each human turn, the bot ponders for BENCH_PONDER_TIME seconds, then searches its move with the memory of the game
+ * The games are played without and with pondering, the share of the root visits kept from the earlier searches must grow with it
+ */
+static void bench_mcts_ponder(const i32 games_nb, const i32 depth, const u64 playout_budget)
+{
+    BotSettings settings[2]; // human, bot
+    init_bench_settings(&settings[0], depth);
+    settings[0].endgame_threshold = 0;
+    settings[1] = settings[0];
+    settings[1].engine = BOT_ENGINE_MCTS;
+    settings[1].playout_budget = playout_budget;
+    f64 reuse_rates[2]; // without and with pondering
+
+    for (i32 ponder = 0; ponder < 2; ponder++) {
+        settings[1].ponder = ponder;
+        u64 playouts = 0;
+        u64 reused_visits = 0;
+        i32 searches_nb = 0;
+        i32 reusing_searches_nb = 0;
+
+        for (i32 game = 0; game < games_nb; game++) {
+            bench_random_state = 0x9E3779B97F4A7C15ULL * (game + 1);
+            Tile board[BOARD_ROWS_NB][BOARD_COLUMNS_NB];
+            deal_bench_board(board);
+            Tile stack_top_card = {EMPTY_TILE, false};
+            SearchMemory *memory = create_search_memory(&settings[1]);
+            BotPonder *bot_ponder = NULL;
+
+            // The human is player 1, as in start_bot_ponder() and start_bot_search()
+            while (true) {
+                Position pos = position_from_board(board, stack_top_card.type, PLAYER1);
+                pos.side_to_move = (game + count_bits(pos.tokens[0] | pos.tokens[1])) & 1;
+                pos.key = position_compute_key(&pos);
+                i32 cell;
+                if (pos.side_to_move == 0) {
+                    bot_ponder = start_bot_ponder(board, stack_top_card, &settings[1], memory);
+                    cell = search_best_move(&pos, &settings[0], NULL, NULL);
+                    const f64 human_end_time = get_precise_time() + BENCH_PONDER_TIME;
+                    while (get_precise_time() < human_end_time) {
+                    }
+                }
+                else {
+                    stop_bot_ponder(bot_ponder);
+                    bot_ponder = NULL;
+                    SearchStats stats;
+                    cell = search_best_move_with_memory(&pos, &settings[1], memory, NULL, &stats);
+                    playouts += stats.nodes;
+                    reused_visits += stats.mcts_reused;
+                    searches_nb++;
+                    reusing_searches_nb += (stats.mcts_reused > 0);
+                }
+
+                const i32 mover = pos.side_to_move;
+                Tile *tile = &board[cell / BOARD_COLUMNS_NB][cell % BOARD_COLUMNS_NB];
+                stack_top_card.type = tile->type;
+                tile->type = (mover == 0) ? TOKEN_PLAYER1 : TOKEN_PLAYER2;
+                position_make_move(&pos, cell);
+                if (position_is_full(&pos) || is_winning_cell(pos.tokens[mover], cell) || position_legal_moves(&pos) == 0) {
+                    break;
+                }
+            }
+            stop_bot_ponder(bot_ponder);
+            destroy_search_memory(memory);
+        }
+
+        reuse_rates[ponder] = 100.0 * (f64)reused_visits / (f64)(reused_visits + playouts);
+        printf("%s: %d bot moves, %d of them reused visits, %.1f%% of the root visits kept from the earlier searches\n", ponder ? "ponder on " : "ponder off",
+               searches_nb, reusing_searches_nb, reuse_rates[ponder]);
+    }
+
+    if (reuse_rates[1] <= reuse_rates[0]) {
+        printf("warning: the bot searches kept less of the pondering than of their own earlier searches\n");
+    }
+}
+
+/**
+ * Run the MCTS on the positions with 1 to `max_threads` threads, each search with the same playout budget
+ * The throughput is given in playouts per second and per second and core (the threads beyond the cores share them), the agreement is the share of the best moves that match the single thread ones
+ */
+static void bench_mcts_threads(const i32 positions_nb, const u64 playout_budget, const i32 max_threads)
+{
+    BotSettings settings;
+    init_bench_settings(&settings, BOT_DEFAULT_MAX_DEPTH);
+    settings.engine = BOT_ENGINE_MCTS;
+    settings.playout_budget = playout_budget;
+
+    i32 best_cells[BENCH_MAX_POSITIONS_NB];
+    f64 single_thread_rate = 0;
+    const i32 cores_nb = (i32)sysconf(_SC_NPROCESSORS_ONLN);
+
+    printf("%8s %14s %10s %14s %16s %8s %10s\n", "threads", "playouts", "time (s)", "playouts/s", "playouts/s/core", "scaling", "agreement");
+    for (i32 threads = 1; threads <= max_threads; threads++) {
+        settings.threads = threads;
+        u64 total_playouts = 0;
+        f64 total_time = 0;
+        i32 agreements = 0;
+
+        for (i32 i = 0; i < positions_nb; i++) {
+            const Position pos = get_bench_position(i);
+            SearchStats stats;
+            search_best_move(&pos, &settings, NULL, &stats);
+            total_playouts += stats.nodes;
+            total_time += stats.time;
+
+            if (threads == 1) {
+                best_cells[i] = stats.best_cell;
+            }
+            agreements += (stats.best_cell == best_cells[i]);
+        }
+
+        const f64 rate = (f64)total_playouts / total_time;
+        if (threads == 1) {
+            single_thread_rate = rate;
+        }
+        const i32 cores = (threads < cores_nb) ? threads : cores_nb;
+        printf("%8d %14llu %10.3f %14.0f %16.0f %7.2fx %9.1f%%\n", threads, total_playouts, total_time, rate, rate / cores, rate / single_thread_rate, 100.0 * agreements / positions_nb);
+    }
+}
+
+/**
+ * Search the positions with 1 to `max_threads` threads and print the speedup of each thread count over one thread
+ * The speedup compares the times to finish the same searches, the node counts of each thread are summed over the positions
+ * The endgame solver is disabled, it would search the end of the game on one thread
+ */
+static void bench_threads(const BotParallelism parallelism, const BotAlgorithm algorithm, const i32 positions_nb, const i32 depth, const i32 max_threads)
+{
+    BotSettings settings;
+    init_bench_settings(&settings, depth);
+    settings.endgame_threshold = 0;
+    settings.parallelism = parallelism;
+    settings.algorithm = algorithm;
+
+    i32 scores[BENCH_MAX_POSITIONS_NB];
+    f64 single_thread_time = 0;
+
+    printf("%8s %14s %10s %8s %11s  %s\n", "threads", "nodes", "time (s)", "speedup", "efficiency", "nodes per thread");
+    for (i32 threads = 1; threads <= max_threads; threads++) {
+        settings.threads = threads;
+        u64 total_nodes = 0;
+        u64 thread_nodes[BOT_MAX_THREADS] = {0};
+        f64 total_time = 0;
+
+        for (i32 i = 0; i < positions_nb; i++) {
+            const Position pos = get_bench_position(i);
+            SearchStats stats;
+            search_best_move(&pos, &settings, NULL, &stats);
+            total_nodes += stats.nodes;
+            total_time += stats.time;
+            for (i32 thread = 0; thread < stats.threads; thread++) {
+                thread_nodes[thread] += stats.thread_nodes[thread];
+            }
+
+            if (threads == 1) {
+                scores[i] = stats.score;
+            }
+            else if (stats.score != scores[i]) {
+                printf("warning: position %d scores differ (%d / %d)\n", i, scores[i], stats.score);
+            }
+        }
+
+        if (threads == 1) {
+            single_thread_time = total_time;
+        }
+        const f64 speedup = single_thread_time / total_time;
+        printf("%8d %14llu %10.3f %7.2fx %10.1f%% ", threads, total_nodes, total_time, speedup, 100.0 * speedup / threads);
+        for (i32 thread = 0; thread < threads; thread++) {
+            printf(" %llu", thread_nodes[thread]);
+        }
+        printf("\n");
+    }
+}
+
+/**
+ * Thread count given after the mode, positions and depth (or playout budget), all the cores by default
+ */
+static i32 get_bench_max_threads(const i32 argc, char **argv)
+{
+    const i32 max_threads = (argc > 4) ? atoi(argv[4]) : (i32)sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_threads < 1) {
+        return 1;
+    }
+    if (max_threads > BOT_MAX_THREADS) {
+        return BOT_MAX_THREADS;
+    }
+    return max_threads;
+}
+
+static void print_usage(void)
+{
+    printf("usage: bench_bot ordering|algorithms|sliced|endgame|symmetry|memory [positions_nb] [depth]\n");
+    printf("       bench_bot evaluation [positions_nb] [rounds_nb]\n");
+    printf("       bench_bot evaluation-batch [positions_nb] [copies_nb] [max_threads]\n");
+    printf("       bench_bot network [positions_nb] [depth] [network_path]\n");
+    printf("       bench_bot playouts [positions_nb] [playouts_nb]\n");
+    printf("       bench_bot mcts|mcts-ponder [games_nb] [depth] [playout_budget]\n");
+    printf("       bench_bot mcts-threads [positions_nb] [playout_budget] [max_threads]\n");
+    printf("       bench_bot root-split|lazy-smp|work-stealing [positions_nb] [depth] [max_threads] [minimax|pvs]\n");
+}
+
+i32 main(i32 argc, char **argv)
+{
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    const i32 positions_nb = (argc > 2) ? atoi(argv[2]) : BENCH_DEFAULT_POSITIONS_NB;
+    const i32 depth = (argc > 3) ? atoi(argv[3]) : BENCH_DEFAULT_DEPTH;
+    if (positions_nb < 1 || positions_nb > BENCH_MAX_POSITIONS_NB) {
+        printf("positions_nb must be between 1 and %d\n", BENCH_MAX_POSITIONS_NB);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "ordering") == 0) {
+        bench_move_ordering(positions_nb, depth);
+    }
+    else if (strcmp(argv[1], "algorithms") == 0) {
+        bench_algorithms(positions_nb, depth);
+    }
+    else if (strcmp(argv[1], "sliced") == 0) {
+        bench_sliced(positions_nb, depth);
+    }
+    else if (strcmp(argv[1], "endgame") == 0) {
+        bench_endgame(positions_nb, depth);
+    }
+    else if (strcmp(argv[1], "symmetry") == 0) {
+        bench_symmetry(positions_nb, depth);
+    }
+    else if (strcmp(argv[1], "memory") == 0) {
+        bench_memory(positions_nb, depth);
+    }
+    else if (strcmp(argv[1], "evaluation") == 0) {
+        const i32 rounds_nb = (argc > 3) ? atoi(argv[3]) : BENCH_DEFAULT_EVALUATION_ROUNDS;
+        bench_evaluation(positions_nb, rounds_nb);
+    }
+    else if (strcmp(argv[1], "evaluation-batch") == 0) {
+        const u32 copies_nb = (argc > 3) ? (u32)strtoul(argv[3], NULL, 10) : BENCH_DEFAULT_EVALUATION_COPIES;
+        bench_evaluation_batch(positions_nb, copies_nb, get_bench_max_threads(argc, argv));
+    }
+    else if (strcmp(argv[1], "network") == 0) {
+        const i32 network_depth = (argc > 3) ? depth : BENCH_DEFAULT_NETWORK_DEPTH;
+        bench_network(positions_nb, network_depth, (argc > 4) ? argv[4] : BENCH_DEFAULT_NETWORK_PATH);
+    }
+    else if (strcmp(argv[1], "playouts") == 0) {
+        const u32 playouts_nb = (argc > 3) ? (u32)strtoul(argv[3], NULL, 10) : BENCH_DEFAULT_PLAYOUTS_NB;
+        bench_playouts(positions_nb, playouts_nb);
+    }
+    else if (strcmp(argv[1], "mcts") == 0) {
+        const u64 playout_budget = (argc > 4) ? strtoull(argv[4], NULL, 10) : BENCH_DEFAULT_PLAYOUT_BUDGET;
+        bench_mcts(positions_nb, depth, playout_budget);
+    }
+    else if (strcmp(argv[1], "mcts-ponder") == 0) {
+        const u64 playout_budget = (argc > 4) ? strtoull(argv[4], NULL, 10) : BENCH_DEFAULT_PLAYOUT_BUDGET;
+        bench_mcts_ponder(positions_nb, depth, playout_budget);
+    }
+    else if (strcmp(argv[1], "mcts-threads") == 0) {
+        const u64 playout_budget = (argc > 3) ? strtoull(argv[3], NULL, 10) : BENCH_DEFAULT_MCTS_THREADS_PLAYOUTS;
+        bench_mcts_threads(positions_nb, playout_budget, get_bench_max_threads(argc, argv));
+    }
+    else if (strcmp(argv[1], "root-split") == 0 || strcmp(argv[1], "lazy-smp") == 0 || strcmp(argv[1], "work-stealing") == 0) {
+        const i32 max_threads = get_bench_max_threads(argc, argv);
+        BotParallelism parallelism = BOT_PARALLEL_ROOT_SPLIT;
+        if (strcmp(argv[1], "lazy-smp") == 0) {
+            parallelism = BOT_PARALLEL_LAZY_SMP;
+        }
+        else if (strcmp(argv[1], "work-stealing") == 0) {
+            parallelism = BOT_PARALLEL_WORK_STEALING;
+        }
+        const BotAlgorithm algorithm = (argc > 5 && strcmp(argv[5], "pvs") == 0) ? BOT_ALGORITHM_PVS : BOT_ALGORITHM_MINIMAX;
+        bench_threads(parallelism, algorithm, positions_nb, depth, max_threads);
+    }
+    else {
+        print_usage();
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * Whole game solver
+ * Computes the exact value of a deal for the first player and its optimal first moves
+ *
+ * usage: solve_deal seed <seed> [deals_nb]    solve the deals the game serves after srand(seed), srand(seed + 1)...
+ *        solve_deal cards <card> x16          solve a deal given as the 16 cards (0-15) in board order
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game_botbrain.h"
+
+static const char *get_outcome_name(const GameOutcome outcome)
+{
+    switch (outcome) {
+        case OUTCOME_WIN:
+            return "win";
+        case OUTCOME_DRAW:
+            return "draw";
+        case OUTCOME_LOSS:
+            return "loss";
+    }
+    UNREACHABLE();
+    return "";
+}
+
+/**
+ * Print the solution of a deal, with the value of every first move on a grid laid out like the board
+ * W, D and L are the outcomes for the first player, followed by the number of plies to the end of the game
+ */
+static void print_solution(const Tile board[][BOARD_COLUMNS_NB], const DealSolution *solution)
+{
+    printf("first player %s in %d plies, best first move {row: %d, col: %d} (%llu nodes, %.3f s)\n", get_outcome_name(solution->outcome), solution->distance, solution->best_cell % BOARD_COLUMNS_NB + 1, solution->best_cell / BOARD_COLUMNS_NB + 1, solution->nodes, solution->time);
+
+    for (i32 row = 0; row < BOARD_COLUMNS_NB; row++) {
+        printf("   ");
+        for (i32 col = 0; col < BOARD_ROWS_NB; col++) {
+            const i32 cell = CELL_INDEX(col, row);
+            const DealMoveValue *value = &solution->moves[cell];
+            if (value->distance < 0) {
+                printf(" %2d:---", board[col][row].type);
+            }
+            else {
+                printf(" %2d:%c%2d", board[col][row].type, "LDW"[value->outcome + 1], value->distance);
+            }
+        }
+        printf("\n");
+    }
+}
+
+static void solve_seeds(const u32 seed, const i32 deals_nb)
+{
+    i32 outcomes_nb[3] = {0, 0, 0};
+    f64 total_time = 0;
+
+    for (i32 i = 0; i < deals_nb; i++) {
+        Tile board[BOARD_ROWS_NB][BOARD_COLUMNS_NB];
+        srand(seed + i);
+        deal_cards(board);
+
+        const DealSolution solution = solve_deal(board);
+        outcomes_nb[solution.outcome + 1]++;
+        total_time += solution.time;
+
+        printf("seed %u: ", seed + i);
+        print_solution(board, &solution);
+    }
+
+    if (deals_nb > 1) {
+        printf("%d deals: %d first player wins, %d draws, %d first player losses (%.3f s)\n", deals_nb, outcomes_nb[2], outcomes_nb[1], outcomes_nb[0], total_time);
+    }
+}
+
+static b32 solve_cards(char **cards_text)
+{
+    Tile board[BOARD_ROWS_NB][BOARD_COLUMNS_NB];
+    u16 used_cards = 0;
+
+    for (i32 i = 0; i < BOARD_CELLS_NB; i++) {
+        const i32 card = atoi(cards_text[i]);
+        if (card < 0 || card >= CARD_TYPES_NB || (used_cards & (1 << card))) {
+            printf("the deal must contain each card from 0 to %d once\n", CARD_TYPES_NB - 1);
+            return false;
+        }
+        used_cards |= 1 << card;
+        board[i / BOARD_COLUMNS_NB][i % BOARD_COLUMNS_NB].type = (TileType)card;
+        board[i / BOARD_COLUMNS_NB][i % BOARD_COLUMNS_NB].is_pressed = false;
+    }
+
+    const DealSolution solution = solve_deal(board);
+    print_solution(board, &solution);
+    return true;
+}
+
+static void print_usage(void)
+{
+    printf("usage: solve_deal seed <seed> [deals_nb]\n");
+    printf("       solve_deal cards <card> x%d\n", BOARD_CELLS_NB);
+}
+
+i32 main(i32 argc, char **argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "seed") == 0) {
+        const i32 deals_nb = (argc > 3) ? atoi(argv[3]) : 1;
+        solve_seeds((u32)strtoul(argv[2], NULL, 10), deals_nb);
+    }
+    else if (argc == 2 + BOARD_CELLS_NB && strcmp(argv[1], "cards") == 0) {
+        if (!solve_cards(&argv[2])) {
+            return 1;
+        }
+    }
+    else {
+        print_usage();
+        return 1;
+    }
+    return 0;
+}
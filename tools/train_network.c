@@ -0,0 +1,300 @@
+/**
+ * Evaluation network trainer
+ * Plays random moves on random deals, labels the positions with their exact value from the endgame solver,
+ * fits the network of game_botbrain.h in floating point, then quantizes it to int8 and writes it in the format of load_evaluation_network()
+ * The default network file is the one that the game loads at the start of a one player game
+ *
+ * usage: train_network [positions_nb] [epochs_nb] [network_path]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "game_botbrain.h"
+
+#define TRAIN_DEFAULT_POSITIONS_NB 200000
+#define TRAIN_DEFAULT_EPOCHS_NB 12
+#define TRAIN_DEFAULT_NETWORK_PATH "./src/assets/evaluation_network.bin"
+#define TRAIN_SEED 1
+#define TRAIN_MAX_PLIES 11          // deeper positions are solved by the search and never evaluated
+#define TRAIN_VALIDATION_SHARE 10   // one position out of this number is kept for the validation
+#define TRAIN_LEARNING_RATE 0.02f
+#define TRAIN_WEIGHT_SCALE 127.0f   // the feature weights and the activations in [0, 1] are stored times this scale
+#define TRAIN_OUTPUT_SCALE 64.0f    // the output weights are stored times this scale
+#define TRAIN_OUTPUT_SHIFT 5        // a value of 1 (a won game) is worth 127 * 64 >> 5 = 254 points
+
+typedef struct {
+    Position pos;
+    u8 states[WIN_PATTERNS_NB];
+    f32 value; // exact value of the game for player 1: 1 won, 0 drawn, -1 lost
+} TrainingPosition;
+
+/**
+ * Floating point copy of EvaluationNetwork, the weights are kept in the range that quantizes to int8
+ */
+typedef struct {
+    f32 feature_weights[NETWORK_FEATURES_NB][NETWORK_HIDDEN_NB];
+    f32 hidden_biases[NETWORK_HIDDEN_NB];
+    f32 output_weights[NETWORK_HIDDEN_NB];
+    f32 output_bias;
+} TrainingNetwork;
+
+static f32 get_random_weight(const f32 amplitude)
+{
+    return amplitude * (2.0f * (f32)rand() / (f32)RAND_MAX - 1.0f);
+}
+
+static f32 clamp_weight(const f32 weight, const f32 limit)
+{
+    return (weight > limit) ? limit : (weight < -limit) ? -limit : weight;
+}
+
+/**
+ * Deal random cards and play random legal moves, the game must not be over
+ */
+static Position make_training_position(void)
+{
+    while (true) {
+        Tile board[BOARD_ROWS_NB][BOARD_COLUMNS_NB];
+        deal_cards(board);
+        Position pos = position_from_board(board, EMPTY_TILE, PLAYER1);
+
+        const i32 plies = 1 + rand() % TRAIN_MAX_PLIES;
+        b32 is_over = false;
+        for (i32 ply = 0; ply < plies && !is_over; ply++) {
+            u16 moves = position_legal_moves(&pos);
+            if (moves == 0) {
+                is_over = true;
+                break;
+            }
+            for (i32 skip = rand() % count_bits(moves); skip > 0; skip--) {
+                moves &= moves - 1;
+            }
+            const i32 cell = __builtin_ctz(moves);
+            position_make_move(&pos, cell);
+            is_over = is_winning_cell(pos.tokens[pos.side_to_move ^ 1], cell);
+        }
+
+        if (!is_over && position_legal_moves(&pos) != 0 && !position_is_full(&pos)) {
+            return pos;
+        }
+    }
+}
+
+static void make_training_positions(TrainingPosition *positions, const i32 positions_nb)
+{
+    for (i32 i = 0; i < positions_nb; i++) {
+        const Position pos = make_training_position();
+        const EndgameResult result = solve_endgame(&pos, INFINITY, 0, NULL);
+        Evaluator eval;
+        evaluator_init(&eval, &pos, NULL);
+
+        positions[i].pos = pos;
+        memcpy(positions[i].states, eval.states, sizeof(eval.states));
+        positions[i].value = (f32)((pos.side_to_move == 0) ? result.outcome : -result.outcome);
+    }
+}
+
+static f32 forward_training_network(const TrainingNetwork *network, const u8 *states, f32 *activations)
+{
+    f32 output = network->output_bias;
+    for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+        f32 hidden = network->hidden_biases[i];
+        for (i32 pattern = 0; pattern < WIN_PATTERNS_NB; pattern++) {
+            hidden += network->feature_weights[pattern * PATTERN_STATES_NB + states[pattern]][i];
+        }
+        activations[i] = (hidden < 0.0f) ? 0.0f : (hidden > 1.0f) ? 1.0f : hidden;
+        output += network->output_weights[i] * activations[i];
+    }
+    return output;
+}
+
+/**
+ * One step of stochastic gradient descent on the squared error, the clipped ReLU has no gradient outside of [0, 1]
+ */
+static void train_on_position(TrainingNetwork *network, const TrainingPosition *position, const f32 learning_rate)
+{
+    f32 activations[NETWORK_HIDDEN_NB];
+    const f32 error = forward_training_network(network, position->states, activations) - position->value;
+    const f32 output_limit = 127.0f / TRAIN_OUTPUT_SCALE;
+
+    for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+        const f32 hidden_gradient = (activations[i] > 0.0f && activations[i] < 1.0f) ? error * network->output_weights[i] : 0.0f;
+        network->output_weights[i] = clamp_weight(network->output_weights[i] - learning_rate * error * activations[i], output_limit);
+        if (hidden_gradient == 0.0f) {
+            continue;
+        }
+        network->hidden_biases[i] = clamp_weight(network->hidden_biases[i] - learning_rate * hidden_gradient, 64.0f);
+        for (i32 pattern = 0; pattern < WIN_PATTERNS_NB; pattern++) {
+            f32 *weight = &network->feature_weights[pattern * PATTERN_STATES_NB + position->states[pattern]][i];
+            *weight = clamp_weight(*weight - learning_rate * hidden_gradient, 1.0f);
+        }
+    }
+    network->output_bias -= learning_rate * error;
+}
+
+static void quantize_network(const TrainingNetwork *network, EvaluationNetwork *quantized)
+{
+    for (i32 feature = 0; feature < NETWORK_FEATURES_NB; feature++) {
+        for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+            quantized->feature_weights[feature][i] = (i8)lroundf(network->feature_weights[feature][i] * TRAIN_WEIGHT_SCALE);
+        }
+    }
+    for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+        quantized->hidden_biases[i] = (i16)lroundf(network->hidden_biases[i] * TRAIN_WEIGHT_SCALE);
+        quantized->output_weights[i] = (i8)lroundf(network->output_weights[i] * TRAIN_OUTPUT_SCALE);
+    }
+    quantized->output_bias = (i32)lroundf(network->output_bias * TRAIN_WEIGHT_SCALE * TRAIN_OUTPUT_SCALE);
+    quantized->output_shift = TRAIN_OUTPUT_SHIFT;
+}
+
+static i32 get_sign(const f32 value)
+{
+    return (value > 0.0f) - (value < 0.0f);
+}
+
+/**
+ * Print the squared error of the float network and how often the quantized network puts the validation positions
+ * on the right side of a draw
+ */
+static void print_validation(const TrainingNetwork *network, const EvaluationNetwork *quantized, const TrainingPosition *positions, const i32 positions_nb)
+{
+    // A network score closer to a draw than to a won or lost game is read as a draw
+    const f32 draw_margin = 0.5f * TRAIN_WEIGHT_SCALE * TRAIN_OUTPUT_SCALE / (f32)(1 << TRAIN_OUTPUT_SHIFT);
+    f64 squared_error = 0;
+    i32 hits = 0;
+    i32 validation_nb = 0;
+
+    for (i32 i = 0; i < positions_nb; i++) {
+        if (i % TRAIN_VALIDATION_SHARE != 0) {
+            continue;
+        }
+        f32 activations[NETWORK_HIDDEN_NB];
+        const f32 error = forward_training_network(network, positions[i].states, activations) - positions[i].value;
+        squared_error += error * error;
+
+        Evaluator eval;
+        evaluator_init(&eval, &positions[i].pos, quantized);
+        const i32 network_score = evaluator_score(&eval, &positions[i].pos, 0);
+        hits += (get_sign((fabsf((f32)network_score) < draw_margin) ? 0.0f : (f32)network_score) == get_sign(positions[i].value));
+        validation_nb++;
+    }
+
+    printf("validation: %d positions, mean squared error %.4f, right side of a draw %.1f%%\n", validation_nb, squared_error / validation_nb, 100.0 * hits / validation_nb);
+}
+
+/**
+ * Print how often the pattern table puts the validation positions on the right side of a draw, the network has to do better
+ * The validation positions are scored in one batch by evaluate_positions(), on all the cores
+ */
+static void print_pattern_validation(const TrainingPosition *positions, const i32 positions_nb)
+{
+    const i32 validation_nb = (positions_nb + TRAIN_VALIDATION_SHARE - 1) / TRAIN_VALIDATION_SHARE;
+    Position *validation = (Position *)malloc(validation_nb * sizeof(Position));
+    i32 *scores = (i32 *)malloc(validation_nb * sizeof(i32));
+    if (validation == NULL || scores == NULL) {
+        printf("cannot allocate %d validation positions\n", validation_nb);
+        free(validation);
+        free(scores);
+        return;
+    }
+    for (i32 i = 0; i < validation_nb; i++) {
+        validation[i] = positions[i * TRAIN_VALIDATION_SHARE].pos;
+    }
+
+    const f64 start_time = get_precise_time();
+    evaluate_positions(validation, scores, (u32)validation_nb, (i32)sysconf(_SC_NPROCESSORS_ONLN));
+    const f64 time = get_precise_time() - start_time;
+
+    i32 hits = 0;
+    for (i32 i = 0; i < validation_nb; i++) {
+        hits += (get_sign((f32)scores[i]) == get_sign(positions[i * TRAIN_VALIDATION_SHARE].value));
+    }
+    printf("pattern table: %d positions scored in %.4f s, right side of a draw %.1f%%\n", validation_nb, time, 100.0 * hits / validation_nb);
+
+    free(validation);
+    free(scores);
+}
+
+static void print_usage(void)
+{
+    printf("usage: train_network [positions_nb] [epochs_nb] [network_path]\n");
+}
+
+i32 main(i32 argc, char **argv)
+{
+    const i32 positions_nb = (argc > 1) ? atoi(argv[1]) : TRAIN_DEFAULT_POSITIONS_NB;
+    const i32 epochs_nb = (argc > 2) ? atoi(argv[2]) : TRAIN_DEFAULT_EPOCHS_NB;
+    const char *network_path = (argc > 3) ? argv[3] : TRAIN_DEFAULT_NETWORK_PATH;
+    if (positions_nb < TRAIN_VALIDATION_SHARE || epochs_nb < 1) {
+        print_usage();
+        return 1;
+    }
+
+    srand(TRAIN_SEED);
+    TrainingPosition *positions = (TrainingPosition *)malloc(positions_nb * sizeof(TrainingPosition));
+    TrainingNetwork *network;
+    ALLOC_VAR(network, TrainingNetwork);
+    EvaluationNetwork *quantized;
+    ALLOC_VAR(quantized, EvaluationNetwork);
+    if (positions == NULL) {
+        printf("cannot allocate %d positions\n", positions_nb);
+        return 1;
+    }
+
+    f64 start_time = get_precise_time();
+    make_training_positions(positions, positions_nb);
+    printf("%d positions solved in %.1f s\n", positions_nb, get_precise_time() - start_time);
+    print_pattern_validation(positions, positions_nb);
+
+    // The hidden units start in the middle of the clipped ReLU, where they have a gradient
+    for (i32 feature = 0; feature < NETWORK_FEATURES_NB; feature++) {
+        for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+            network->feature_weights[feature][i] = get_random_weight(0.05f);
+        }
+    }
+    for (i32 i = 0; i < NETWORK_HIDDEN_NB; i++) {
+        network->hidden_biases[i] = 0.5f;
+        network->output_weights[i] = get_random_weight(0.5f);
+    }
+
+    i32 *order = (i32 *)malloc(positions_nb * sizeof(i32));
+    i32 training_nb = 0;
+    for (i32 i = 0; i < positions_nb; i++) {
+        if (i % TRAIN_VALIDATION_SHARE != 0) {
+            order[training_nb++] = i;
+        }
+    }
+
+    for (i32 epoch = 0; epoch < epochs_nb; epoch++) {
+        start_time = get_precise_time();
+        for (i32 i = training_nb - 1; i > 0; i--) {
+            const i32 j = rand() % (i + 1);
+            const i32 temp = order[i];
+            order[i] = order[j];
+            order[j] = temp;
+        }
+        const f32 learning_rate = TRAIN_LEARNING_RATE / (1.0f + epoch);
+        for (i32 i = 0; i < training_nb; i++) {
+            train_on_position(network, &positions[order[i]], learning_rate);
+        }
+
+        quantize_network(network, quantized);
+        printf("epoch %d (%.1f s) ", epoch + 1, get_precise_time() - start_time);
+        print_validation(network, quantized, positions, positions_nb);
+    }
+
+    const b32 is_saved = save_evaluation_network(quantized, network_path);
+    if (is_saved) {
+        printf("network written to %s\n", network_path);
+    }
+
+    free(order);
+    free(quantized);
+    free(network);
+    free(positions);
+    return is_saved ? 0 : 1;
+}